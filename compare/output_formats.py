@@ -0,0 +1,119 @@
+"""Compare file size and bulk read throughput of the rootfile output formats.
+
+Produce the same sample once per `OutputFormat` of the
+MakeHiggsVariablesProcessor (TTree, RNTuple, Parquet). Use a different
+`OutputRootFile` for the TTree and the RNTuple run, since both end in .root.
+Then pass the files to this script, e.g.:
+
+    python3 output_formats.py data/new_with_overlay.root \
+        data/new_with_overlay_rntuple.root data/new_with_overlay.parquet
+
+Without Marlin, `--synthetic N` writes N random events with the scalar columns
+of the processor as a TTree and a Parquet file (both ZLIB/GZIP level 1, the
+processor's default compression) to the current directory and compares them:
+
+    python3 output_formats.py --synthetic 1000000
+
+Add `--markdown` for a table that can be pasted into the README.
+
+Reading the RNTuple needs uproot>=5.3, reading the Parquet file needs pyarrow.
+"""
+import sys
+import time
+from pathlib import Path
+
+
+INT_COLUMNS = [
+    "run", "event", "n_isolated_leptons", "n_pfos", "n_pfos_not_forward",
+    "n_charged_hadrons", "n_neutral_hadrons", "n_gamma", "n_electrons",
+    "n_muons", "h_invisible", "h_decay", "n_tagged_jets",
+]
+FLOAT_COLUMNS = [
+    "e_h", "m_h", "m_h_recoil", "cos_theta_miss", "prescale_weight",
+    "b_tag_jet1", "b_tag_jet2", "c_tag_jet1", "c_tag_jet2", "b_tag_max",
+    "c_tag_max",
+]
+
+
+def syntheticColumns(n_events, seed=1):
+    """Random values in the ranges of the processor's columns."""
+    import numpy as np
+    rng = np.random.default_rng(seed)
+    columns = {name: rng.poisson(10, n_events).astype(np.int32)
+               for name in INT_COLUMNS}
+    columns["run"] = np.full(n_events, 250000, dtype=np.int32)
+    columns["event"] = np.arange(n_events, dtype=np.int32)
+    columns["h_invisible"] = (rng.random(n_events) < 0.01).astype(np.int32)
+    columns["h_decay"] = rng.choice([4, 5, 13, 15, 21, 22, 23, 24], n_events,
+                                    p=[.03, .58, .01, .06, .08, .01, .02, .21]
+                                    ).astype(np.int32)
+    for name in FLOAT_COLUMNS:
+        columns[name] = rng.random(n_events, dtype=np.float32)
+    columns["e_h"] = rng.normal(150, 20, n_events).astype(np.float32)
+    columns["m_h"] = rng.normal(125, 10, n_events).astype(np.float32)
+    columns["m_h_recoil"] = rng.normal(125, 5, n_events).astype(np.float32)
+    columns["cos_theta_miss"] = rng.uniform(-1, 1, n_events).astype(np.float32)
+    columns["prescale_weight"] = np.ones(n_events, dtype=np.float32)
+    return columns
+
+
+def writeSynthetic(n_events, tree_name="higgs"):
+    """Write the synthetic sample in each format. Returns the file paths."""
+    import pyarrow
+    import pyarrow.parquet as pq
+    import uproot
+    columns = syntheticColumns(n_events)
+    tree_path = Path(f"synthetic_{n_events}.root")
+    with uproot.recreate(tree_path, compression=uproot.ZLIB(1)) as file:
+        file[tree_name] = columns
+    parquet_path = Path(f"synthetic_{n_events}.parquet")
+    pq.write_table(pyarrow.table(columns), parquet_path,
+                   compression="gzip", compression_level=1)
+    return [tree_path, parquet_path]
+
+
+def readColumns(path, tree_name="higgs"):
+    """Read all columns in bulk into numpy arrays, as the notebook does."""
+    if path.suffix == ".parquet":
+        import pyarrow.parquet as pq
+        table = pq.read_table(path)
+        return {name: table[name].to_numpy() for name in table.column_names}
+    import uproot
+    return uproot.open(path)[tree_name].arrays(library="np")
+
+
+def measure(path, repetitions=5):
+    best = float("inf")
+    for _ in range(repetitions):
+        start = time.perf_counter()
+        columns = readColumns(path)
+        best = min(best, time.perf_counter() - start)
+    n_events = len(next(iter(columns.values())))
+    return n_events, best
+
+
+if __name__ == "__main__":
+    arguments = sys.argv[1:]
+    markdown = "--markdown" in arguments
+    if markdown:
+        arguments.remove("--markdown")
+    if arguments[:1] == ["--synthetic"]:
+        paths = writeSynthetic(int(arguments[1]))
+    else:
+        paths = [Path(name) for name in arguments]
+
+    if markdown:
+        print("| file | size/MB | events | read/s | MEvents/s |")
+        print("|---|---:|---:|---:|---:|")
+    else:
+        print(f"{'file':<45} {'size/MB':>9} {'events':>10} {'read/s':>8}"
+              f" {'MEvents/s':>10}")
+    for path in paths:
+        n_events, seconds = measure(path)
+        size = path.stat().st_size / 1e6
+        if markdown:
+            print(f"| {path.name} | {size:.2f} | {n_events} | {seconds:.3f}"
+                  f" | {n_events / seconds / 1e6:.2f} |")
+        else:
+            print(f"{path.name:<45} {size:>9.2f} {n_events:>10}"
+                  f" {seconds:>8.3f} {n_events / seconds / 1e6:>10.2f}")
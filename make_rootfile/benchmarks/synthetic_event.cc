@@ -0,0 +1,155 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <cmath>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// -- LCIO headers.
+#include "EVENT/LCIO.h"
+#include "IMPL/LCCollectionVec.h"
+#include "IMPL/LCRelationImpl.h"
+#include "IMPL/MCParticleImpl.h"
+#include "IMPL/ReconstructedParticleImpl.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "synthetic_event.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+using IMPL::LCCollectionVec;
+using IMPL::MCParticleImpl;
+using EVENT::LCIO;
+
+// Roughly the composition of the stable, visible particles in ννH events.
+const int kStablePdgs[] = {22, 22, 22, 211, -211, 211, -211, 130, 2112, 321,
+                           11, -13};
+// Unstable particles inside the decay trees.
+const int kIntermediatePdgs[] = {511, 421, 413, 113, 223, 111};
+
+// ----------------------------------------------------------------------------
+class MCParticleFactory {
+ public:
+  MCParticleFactory(LCCollectionVec* collection, unsigned seed)
+    : collection_(collection), rng_(seed) {}
+
+  MCParticleImpl* add(int pdg, int status, EVENT::MCParticle* parent,
+                      double momentum_scale = 5) {
+    MCParticleImpl* mcp = new MCParticleImpl();
+    mcp->setPDG(pdg);
+    mcp->setGeneratorStatus(status);
+    double momentum[3] = {momentum_scale * gauss_(rng_),
+                          momentum_scale * gauss_(rng_),
+                          2 * momentum_scale * gauss_(rng_)};
+    mcp->setMomentum(momentum);
+    mcp->setMass(std::abs(pdg) == 22 ? 0 : 0.14);
+    if (parent) mcp->addParent(parent);  // Also adds the daughter link.
+    collection_->addElement(mcp);
+    return mcp;
+  }
+
+  int stablePdg() {
+    return kStablePdgs[rng_() % (sizeof(kStablePdgs) / sizeof(int))];
+  }
+
+ private:
+  LCCollectionVec* collection_;
+  std::mt19937 rng_;
+  std::normal_distribution<double> gauss_{0, 1};
+};
+
+std::vector<MCParticleImpl*> addHiggsDecay(
+    MCParticleFactory& factory, MCParticleImpl* higgs, int higgs_decay) {
+  std::vector<MCParticleImpl*> jets_or_leptons;
+  bool is_self_conjugate = higgs_decay == 21 || higgs_decay == 23;
+  MCParticleImpl* a = factory.add(higgs_decay, 2, higgs, 30);
+  MCParticleImpl* b = factory.add(
+    is_self_conjugate ? higgs_decay : -higgs_decay, 2, higgs, 30);
+  if (higgs_decay == 23 || higgs_decay == 24) {
+    for (MCParticleImpl* boson : {a, b}) {
+      jets_or_leptons.push_back(factory.add(higgs_decay == 23 ? 1 : 2, 2,
+                                            boson, 20));
+      jets_or_leptons.push_back(factory.add(-1, 2, boson, 20));
+    }
+  } else {
+    jets_or_leptons = {a, b};
+  }
+  return jets_or_leptons;
+}
+
+std::unique_ptr<IMPL::LCEventImpl> makeSyntheticEvent(
+    const SyntheticEventConfig& config, int event_number) {
+  std::unique_ptr<IMPL::LCEventImpl> event(new IMPL::LCEventImpl());
+  event->setRunNumber(0);
+  event->setEventNumber(event_number);
+
+  LCCollectionVec* mc_collection = new LCCollectionVec(LCIO::MCPARTICLE);
+  MCParticleFactory factory(mc_collection, 1000003u * event_number
+    + 101u * config.decay_depth + config.n_higgs_pfos);
+
+  // -- Hard process: e+ e- -> ν ν̄ H.
+  MCParticleImpl* electron = factory.add(11, 4, nullptr, 0);
+  MCParticleImpl* positron = factory.add(-11, 4, nullptr, 0);
+  MCParticleImpl* higgs = factory.add(25, 2, electron, 20);
+  higgs->addParent(positron);
+  factory.add(12, 1, electron, 30)->addParent(positron);
+  factory.add(-12, 1, electron, 30)->addParent(positron);
+
+  // -- Higgs decay tree. The generations widen until they can share the stable
+  // particles between them.
+  std::vector<MCParticleImpl*> generation = addHiggsDecay(
+    factory, higgs, config.higgs_decay);
+  std::vector<MCParticleImpl*> next_generation;
+  const int n_intermediate = sizeof(kIntermediatePdgs) / sizeof(int);
+  for (int depth = 0; depth < config.decay_depth; ++depth) {
+    next_generation.clear();
+    bool split = 2 * generation.size() <= std::size_t(config.n_higgs_pfos);
+    for (MCParticleImpl* parent : generation) {
+      for (int d = 0; d < (split ? 2 : 1); ++d) {
+        int pdg = kIntermediatePdgs[(depth + d) % n_intermediate];
+        next_generation.push_back(factory.add(pdg, 2, parent, 3));
+      }
+    }
+    generation.swap(next_generation);
+  }
+  std::vector<MCParticleImpl*> stable;
+  for (int i = 0; i < config.n_higgs_pfos; ++i) {
+    MCParticleImpl* parent = generation[i % generation.size()];
+    stable.push_back(factory.add(factory.stablePdg(), 1, parent, 2));
+  }
+
+  // -- Overlay: Low-pT particles without any relation to the Higgs.
+  for (int i = 0; i < config.n_overlay_pfos; ++i) {
+    stable.push_back(factory.add(factory.stablePdg(), 1, nullptr, 0.5));
+  }
+
+  // -- One PFO per stable, visible MCParticle.
+  LCCollectionVec* pfo_collection = new LCCollectionVec(
+    LCIO::RECONSTRUCTEDPARTICLE);
+  LCCollectionVec* relation_collection = new LCCollectionVec(LCIO::LCRELATION);
+  relation_collection->parameters().setValue(
+    "FromType", LCIO::RECONSTRUCTEDPARTICLE);
+  relation_collection->parameters().setValue("ToType", LCIO::MCPARTICLE);
+  for (MCParticleImpl* mcp : stable) {
+    IMPL::ReconstructedParticleImpl* pfo = new IMPL::ReconstructedParticleImpl();
+    pfo->setType(mcp->getPDG());
+    pfo->setMomentum(mcp->getMomentum());
+    pfo->setEnergy(mcp->getEnergy());
+    pfo->setMass(mcp->getMass());
+    pfo->setCharge(mcp->getCharge());
+    pfo_collection->addElement(pfo);
+    relation_collection->addElement(new IMPL::LCRelationImpl(pfo, mcp, 1.0));
+  }
+
+  LCCollectionVec* isolated_leptons = new LCCollectionVec(
+    LCIO::RECONSTRUCTEDPARTICLE);
+  isolated_leptons->setSubset(true);
+
+  event->addCollection(mc_collection, "MCParticlesSkimmed");
+  event->addCollection(pfo_collection, "PandoraPFOs");
+  event->addCollection(relation_collection, "RecoMCTruthLink");
+  event->addCollection(isolated_leptons, "IsolatedLeptons");
+  return event;
+}
@@ -0,0 +1,40 @@
+/**
+ *  In-memory ννH events for benchmarks that run without cvmfs or LCIO files.
+ *
+ *  Each event holds the collections that the processors of this project read,
+ *  with the default names of the steering file:
+ *    - MCParticlesSkimmed: e+ e- -> ν ν̄ H. The Higgs decays into a pair of
+ *      higgs_decay particles (b quarks by default). Each of them starts a decay
+ *      tree with decay_depth generations of unstable particles, followed by the
+ *      n_higgs_pfos stable particles. Besides, n_overlay_pfos stable overlay
+ *      particles without parents are added.
+ *    - PandoraPFOs: One PFO per stable, visible MCParticle.
+ *    - RecoMCTruthLink: The relations PFO -> MCParticle.
+ *    - IsolatedLeptons: Empty.
+ *
+ *  The events are reproducible for a given configuration and event number.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _SYNTHETIC_EVENT_H_
+#define _SYNTHETIC_EVENT_H_
+// -- C++ STL headers.
+#include <memory>
+
+// -- LCIO headers.
+#include "IMPL/LCEventImpl.h"
+
+struct SyntheticEventConfig {
+  int n_higgs_pfos = 80;
+  int n_overlay_pfos = 200;
+  // Generations of unstable particles between the Higgs daughters and the
+  // stable particles.
+  int decay_depth = 4;
+  // |PDG| of the Higgs daughters: Quarks, 15 or 21. For 23 and 24, each boson
+  // decays into a quark pair first.
+  int higgs_decay = 5;
+};
+
+std::unique_ptr<IMPL::LCEventImpl> makeSyntheticEvent(
+    const SyntheticEventConfig& config, int event_number);
+#endif
@@ -0,0 +1,305 @@
+/**
+ *  Benchmarks of the hot paths of both processors on synthetic events.
+ *
+ *    vvh_benchmark [-n n_events] [-r n_repetitions] [--pfos=a,b,...]
+ *                  [--depths=a,b,...] [--overlay-fraction=f] [--read-ahead=k]
+ *
+ *  No cvmfs and no LCIO files are needed: The events are built in memory, see
+ *  synthetic_event.h. For each point of the sweep over the number of PFOs and
+ *  the decay-tree depth, the mean time per event of each benchmark is printed.
+ *  Of the PFOs, the overlay fraction (default 0.7) does not stem from the
+ *  Higgs.
+ *
+ *  The "source" rows also build each event (in place of reading and decoding
+ *  it from a file), either before processing it or on a second thread, up to
+ *  k events ahead (default 4), as vvh_parallel --read-ahead does.
+ *
+ *  The processEvent benchmarks write their rootfiles to the working directory
+ *  (benchmark_*.root) and remove them at the end.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// -- LCIO headers.
+#include "EVENT/LCCollection.h"
+#include "EVENT/ReconstructedParticle.h"
+#include "IMPL/LCEventImpl.h"
+#include "UTIL/LCRelationNavigator.h"
+
+// -- Marlin headers.
+#include "marlin/Processor.h"
+#include "marlin/StringParameters.h"
+#include "streamlog/streamlog.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "bounded_queue.h"
+#include "higgs_descendant_index.h"
+#include "make_higgs_variables.h"
+#include "marlin_compat.h"
+#include "overlay_remover_truth.h"
+#include "pdg_taxonomy.h"
+#include "synthetic_event.h"
+
+// -- Using-declarations and global constants.
+using Clock = std::chrono::steady_clock;
+using Events = std::vector<std::unique_ptr<IMPL::LCEventImpl>>;
+using RP = EVENT::ReconstructedParticle;
+const char* const kPfos = "PandoraPFOs";
+const char* const kHiggsOnly = "HiggsOnly";
+
+// ----------------------------------------------------------------------------
+std::vector<int> parseList(const std::string& text) {
+  std::vector<int> values;
+  std::stringstream stream(text);
+  std::string value;
+  while (std::getline(stream, value, ',')) values.push_back(std::atoi(value.c_str()));
+  return values;
+}
+
+// The processor does not own its parameters (in Marlin, the XMLParser keeps
+// them): They are added to keep_alive, which must outlive the processor.
+template <typename P>
+std::unique_ptr<P> makeProcessor(
+    const std::string& name,
+    const std::vector<std::pair<std::string, std::string>>& parameters,
+    std::vector<std::shared_ptr<marlin::StringParameters>>& keep_alive) {
+  std::unique_ptr<P> processor(new P());
+  setProcessorName(processor.get(), name);
+  std::shared_ptr<marlin::StringParameters> string_parameters =
+    std::make_shared<marlin::StringParameters>();
+  for (const auto& parameter : parameters) {
+    string_parameters->add(parameter.first, {parameter.second});
+  }
+  keep_alive.push_back(string_parameters);
+  processor->setProcessorParameters(raw(string_parameters));
+  processor->init();
+  return processor;
+}
+
+// Mean time per event in microseconds. Only the body is timed, not the
+// cleanup (e.g. removing the collections that a processor added).
+double usPerEvent(const Events& events, int n_repetitions,
+                  const std::function<void(EVENT::LCEvent*)>& body,
+                  const std::function<void(IMPL::LCEventImpl*)>& cleanup
+                    = std::function<void(IMPL::LCEventImpl*)>()) {
+  Clock::duration total = Clock::duration::zero();
+  for (int r = 0; r < n_repetitions; ++r) {
+    for (const auto& event : events) {
+      Clock::time_point start = Clock::now();
+      body(event.get());
+      total += Clock::now() - start;
+      if (cleanup) cleanup(event.get());
+    }
+  }
+  return std::chrono::duration<double, std::micro>(total).count()
+    / (events.size() * n_repetitions);
+}
+
+// Mean wall time per event, including building the events. With read_ahead
+// > 0, they are built on a second thread while the body runs.
+double usPerSourcedEvent(const SyntheticEventConfig& config, int n_events,
+                         int read_ahead,
+                         const std::function<void(EVENT::LCEvent*)>& body) {
+  using EventPtr = std::unique_ptr<IMPL::LCEventImpl>;
+  Clock::time_point start = Clock::now();
+  if (read_ahead == 0) {
+    for (int i = 0; i < n_events; ++i) body(makeSyntheticEvent(config, i).get());
+  } else {
+    BoundedQueue<EventPtr> queue(read_ahead);
+    std::thread source([&config, n_events, &queue] {
+      for (int i = 0; i < n_events; ++i) {
+        if (!queue.push(makeSyntheticEvent(config, i))) break;
+      }
+      queue.close();
+    });
+    EventPtr event;
+    while (queue.pop(event)) {
+      body(event.get());
+      event.reset();
+    }
+    source.join();
+  }
+  return std::chrono::duration<double, std::micro>(Clock::now() - start)
+    .count() / n_events;
+}
+
+void removeHiggsOnly(IMPL::LCEventImpl* event) {
+  event->removeCollection(kHiggsOnly);
+}
+
+int higgsIndex(const McGraph& graph) {
+  for (int i = 0; i < graph.nCollectionElements(); ++i) {
+    if (graph.pdg(i) == pdg::kHiggs) return i;
+  }
+  return -1;
+}
+
+void printRow(const std::string& name, int n_pfos, int depth, double us) {
+  std::cout << std::left << std::setw(36) << name << std::right
+    << std::setw(8) << n_pfos << std::setw(8) << depth << std::fixed
+    << std::setprecision(2) << std::setw(14) << us << std::endl;
+}
+
+// ----------------------------------------------------------------------------
+void runBenchmarks(const SyntheticEventConfig& config, int n_events,
+                   int n_repetitions, int read_ahead) {
+  Events events;
+  for (int i = 0; i < n_events; ++i) {
+    events.push_back(makeSyntheticEvent(config, i));
+  }
+  const int n_pfos = config.n_higgs_pfos + config.n_overlay_pfos;
+  const int depth = config.decay_depth;
+  auto row = [&](const std::string& name, double us) {
+    printRow(name, n_pfos, depth, us);
+  };
+
+  // Declared before the processors, so that it is destroyed after them.
+  std::vector<std::shared_ptr<marlin::StringParameters>> parameters;
+  std::unique_ptr<OverlayRemoverTruthProcessor> remover =
+    makeProcessor<OverlayRemoverTruthProcessor>("remover", {}, parameters);
+  std::unique_ptr<MakeHiggsVariablesProcessor> with_overlay =
+    makeProcessor<MakeHiggsVariablesProcessor>("with_overlay", {
+      {"OutputRootFile", "benchmark_with_overlay"}}, parameters);
+  std::unique_ptr<MakeHiggsVariablesProcessor> only_higgs =
+    makeProcessor<MakeHiggsVariablesProcessor>("only_higgs", {
+      {"HiggsCollection", kHiggsOnly},
+      {"OutputRootFile", "benchmark_only_higgs"}}, parameters);
+  std::unique_ptr<MakeHiggsVariablesProcessor> fused =
+    makeProcessor<MakeHiggsVariablesProcessor>("fused", {
+      {"FusedOverlayRemoval", "true"},
+      {"OutputRootFile", "benchmark_fused_with_overlay"},
+      {"HiggsOnlyOutputRootFile", "benchmark_fused_only_higgs"}}, parameters);
+
+  // -- Truth matching of the PFOs.
+  row("isFromHiggs (navigator, reference)", usPerEvent(events, n_repetitions,
+    [&](EVENT::LCEvent* event) {
+      EVENT::LCCollection* pfos = event->getCollection(kPfos);
+      UTIL::LCRelationNavigator navigator(
+        event->getCollection("RecoMCTruthLink"));
+      for (int i = 0; i < pfos->getNumberOfElements(); ++i) {
+        remover->isFromHiggs(static_cast<RP*>(pfos->getElementAt(i)), &navigator);
+      }
+    }));
+  HiggsDescendantIndex index;
+  row("isFromHiggs (index)", usPerEvent(events, n_repetitions,
+    [&](EVENT::LCEvent* event) {
+      index.build(event, "MCParticlesSkimmed", "RecoMCTruthLink");
+      EVENT::LCCollection* pfos = event->getCollection(kPfos);
+      for (int i = 0; i < pfos->getNumberOfElements(); ++i) {
+        index.isFromHiggs(static_cast<RP*>(pfos->getElementAt(i)));
+      }
+    }));
+
+  // -- Parts of the MakeHiggsVariablesProcessor.
+  row("getHiggsTruth", usPerEvent(events, n_repetitions,
+    [&](EVENT::LCEvent* event) { with_overlay->getHiggsTruth(event); }));
+  // Only the traversal, the MC graph is built beforehand.
+  Clock::duration jets_time = Clock::duration::zero();
+  for (int r = 0; r < n_repetitions; ++r) {
+    for (const auto& event : events) {
+      with_overlay->getHiggsTruth(event.get());
+      int higgs = higgsIndex(with_overlay->mcGraph());
+      Clock::time_point start = Clock::now();
+      with_overlay->getNTrueJets(higgs);
+      jets_time += Clock::now() - start;
+    }
+  }
+  row("getNTrueJets", std::chrono::duration<double, std::micro>(jets_time)
+    .count() / (events.size() * n_repetitions));
+  row("setHiggsKinematicInfo", usPerEvent(events, n_repetitions,
+    [&](EVENT::LCEvent* event) { with_overlay->setHiggsKinematicInfo(event); }));
+
+  // -- Full processEvent calls.
+  row("processEvent OverlayRemoverTruth", usPerEvent(events, n_repetitions,
+    [&](EVENT::LCEvent* event) { remover->processEvent(event); },
+    removeHiggsOnly));
+  row("processEvent MakeHiggsVariables", usPerEvent(events, n_repetitions,
+    [&](EVENT::LCEvent* event) { with_overlay->processEvent(event); }));
+  row("processEvent chain (3 processors)", usPerEvent(events, n_repetitions,
+    [&](EVENT::LCEvent* event) {
+      with_overlay->processEvent(event);
+      remover->processEvent(event);
+      only_higgs->processEvent(event);
+    }, removeHiggsOnly));
+  row("processEvent fused", usPerEvent(events, n_repetitions,
+    [&](EVENT::LCEvent* event) { fused->processEvent(event); }));
+
+  // -- Building the events and processing them, with and without overlap.
+  auto process_fused = [&](EVENT::LCEvent* event) { fused->processEvent(event); };
+  row("source + fused (synchronous)",
+    usPerSourcedEvent(config, n_events, 0, process_fused));
+  if (read_ahead > 0) {
+    row("source + fused (read-ahead " + std::to_string(read_ahead) + ")",
+      usPerSourcedEvent(config, n_events, read_ahead, process_fused));
+  }
+
+  for (marlin::Processor* p : std::vector<marlin::Processor*>{
+      remover.get(), with_overlay.get(), only_higgs.get(), fused.get()}) {
+    p->end();
+  }
+}
+
+int main(int argc, char** argv) {
+  int n_events = 200;
+  int n_repetitions = 5;
+  std::vector<int> pfo_counts{100, 300, 1000};
+  std::vector<int> depths{2, 4, 8};
+  double overlay_fraction = 0.7;
+  int read_ahead = 4;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-n" && i + 1 < argc) {
+      n_events = std::atoi(argv[++i]);
+    } else if (arg == "-r" && i + 1 < argc) {
+      n_repetitions = std::atoi(argv[++i]);
+    } else if (arg.compare(0, 7, "--pfos=") == 0) {
+      pfo_counts = parseList(arg.substr(7));
+    } else if (arg.compare(0, 9, "--depths=") == 0) {
+      depths = parseList(arg.substr(9));
+    } else if (arg.compare(0, 19, "--overlay-fraction=") == 0) {
+      overlay_fraction = std::atof(arg.substr(19).c_str());
+    } else if (arg.compare(0, 13, "--read-ahead=") == 0) {
+      read_ahead = std::atoi(arg.substr(13).c_str());
+    } else {
+      std::cerr << "Usage: " << argv[0] << " [-n n_events] [-r n_repetitions] "
+        << "[--pfos=a,b,...] [--depths=a,b,...] [--overlay-fraction=f] "
+        << "[--read-ahead=k]" << std::endl;
+      return 1;
+    }
+  }
+
+  streamlog::out.init(std::cout, argv[0]);
+  streamlog::logscope scope(streamlog::out);
+  scope.setLevel<streamlog::WARNING>();
+
+  std::cout << std::left << std::setw(36) << "benchmark" << std::right
+    << std::setw(8) << "n_pfos" << std::setw(8) << "depth"
+    << std::setw(14) << "us/event" << std::endl;
+  for (int n_pfos : pfo_counts) {
+    for (int depth : depths) {
+      SyntheticEventConfig config;
+      config.n_overlay_pfos = static_cast<int>(overlay_fraction * n_pfos);
+      config.n_higgs_pfos = n_pfos - config.n_overlay_pfos;
+      config.decay_depth = depth;
+      runBenchmarks(config, n_events, n_repetitions, read_ahead);
+    }
+  }
+  for (const char* file : {"benchmark_with_overlay", "benchmark_only_higgs",
+                           "benchmark_fused_with_overlay",
+                           "benchmark_fused_only_higgs"}) {
+    std::remove((std::string(file) + ".root").c_str());
+  }
+  return 0;
+}
@@ -0,0 +1,93 @@
+/**
+ *  Bounded blocking queue between one producer and one consumer thread.
+ *
+ *  Used to read ahead: A background thread reads and decodes the next events
+ *  while the processors work on the current one. With a capacity of K, at
+ *  most K events are decoded but not yet processed, so the memory stays
+ *  bounded (K = 1 is double buffering).
+ *    - push() blocks while the queue is full. It returns false once the queue
+ *      was closed, e.g. because the consumer stopped early.
+ *    - pop() blocks while the queue is empty. It returns false once the queue
+ *      is closed and empty.
+ *  An exception of the producer can be handed to the consumer with fail(),
+ *  pop() rethrows it after the queued items.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _BOUNDED_QUEUE_H_
+#define _BOUNDED_QUEUE_H_
+// -- C++ STL headers.
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(std::size_t capacity)
+    : capacity_(capacity > 0 ? capacity : 1) {}
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  bool push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] {
+      return closed_ || items_.size() < capacity_;
+    });
+    if (closed_) return false;
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+    return true;
+  }
+
+  bool pop(T& item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      if (error_) std::rethrow_exception(error_);
+      return false;
+    }
+    item = std::move(items_.front());
+    items_.pop_front();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // No more pushes. Queued items can still be popped.
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+  // The producer failed: Closes the queue with the error.
+  void fail(std::exception_ptr error) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      error_ = error;
+    }
+    close();
+  }
+
+  // The consumer gives up: Drops the queued items and unblocks the producer.
+  void cancel() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    items_.clear();
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+ private:
+  const std::size_t capacity_;
+  std::mutex mutex_{};
+  std::condition_variable not_full_{};
+  std::condition_variable not_empty_{};
+  std::deque<T> items_{};
+  bool closed_ = false;
+  std::exception_ptr error_{};
+};
+#endif
@@ -0,0 +1,25 @@
+/**
+ *  Interface of the processors that declare which LCIO collections they read.
+ *
+ *  A driver can restrict the LCIO reader to the union of these collections
+ *  (LCReader::setReadCollectionNames), so that all other collections of an
+ *  event are skipped without being unpacked. The list must be complete: A
+ *  collection that is not declared by any processor is not available in
+ *  processEvent.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _COLLECTION_CONSUMER_H_
+#define _COLLECTION_CONSUMER_H_
+// -- C++ STL headers.
+#include <string>
+#include <vector>
+
+class CollectionConsumer {
+ public:
+  virtual ~CollectionConsumer() {}
+  // The names of the collections used in processEvent. Valid once the
+  // processor parameters are set.
+  virtual std::vector<std::string> inputCollections() const = 0;
+};
+#endif
@@ -0,0 +1,79 @@
+/**
+ *  Aggregated diagnostics of unexpected input, instead of one log line per
+ *  particle in the event loops.
+ *
+ *  Each condition is counted per kind and PDG code with relaxed atomic
+ *  counters (a fixed, lock-free table per kind). report() returns true only
+ *  for the first few occurrences of a kind, so that the caller formats and
+ *  logs an example just for these.
+ *  All clones of a processor (same name) share one instance. When the last
+ *  user releases it, i.e. in end(), a summary table of all counts is logged.
+ *  The instance also sums the events that the clones saw and kept in the
+ *  prescaled mode of the MakeHiggsVariablesProcessor.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _DIAGNOSTICS_H_
+#define _DIAGNOSTICS_H_
+// -- C++ STL headers.
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class Diagnostics {
+ public:
+  enum Kind {
+    kPfoWithoutMcLink,
+    kUnexpectedPfoPdg,
+    kUnforeseenHiggsDecay,
+    kUnresolvedTauDecay,
+    kStableWithoutJet,  // A stable non-lepton that does not form a jet.
+    kNKinds
+  };
+  static const char* kindName(Kind kind);
+  static const int kDefaultExamples = 5;
+
+  static std::shared_ptr<Diagnostics> open(const std::string& processor,
+                                           int n_examples = kDefaultExamples);
+  // Logs the summary.
+  ~Diagnostics();
+  Diagnostics(const Diagnostics&) = delete;
+  Diagnostics& operator=(const Diagnostics&) = delete;
+
+  // Thread-safe. True if an example of the condition should be logged.
+  bool report(Kind kind, int pdg) {
+    count(kind, pdg);
+    return n_reported_[kind].fetch_add(1, std::memory_order_relaxed) < n_examples_;
+  }
+  long nReported(Kind kind) const {
+    return n_reported_[kind].load(std::memory_order_relaxed);
+  }
+  // Thread-safe. An event of a prescaled decay mode.
+  void countPrescaled(bool kept) {
+    n_prescale_seen_.fetch_add(1, std::memory_order_relaxed);
+    if (kept) n_prescale_kept_.fetch_add(1, std::memory_order_relaxed);
+  }
+
+ private:
+  static const int kNSlots = 64;  // Different PDG codes per kind.
+  static const int kEmptySlot;
+
+  Diagnostics(const std::string& processor, int n_examples);
+  void count(Kind kind, int pdg);
+  void logSummary() const;
+
+  static std::mutex registry_mutex_;
+  static std::map<std::string, std::weak_ptr<Diagnostics>> registry_;
+
+  std::string processor_;
+  int n_examples_;
+  std::atomic<long> n_reported_[kNKinds];
+  std::atomic<long> n_overflow_[kNKinds];  // PDG codes without a free slot.
+  std::atomic<int> pdg_[kNKinds][kNSlots];
+  std::atomic<long> n_per_pdg_[kNKinds][kNSlots];
+  std::atomic<long> n_prescale_seen_;
+  std::atomic<long> n_prescale_kept_;
+};
+#endif
@@ -0,0 +1,90 @@
+/**
+ *  Per-event lookup of the MCParticles (and through them the PFOs) that
+ *  originate from a Higgs boson decay.
+ *
+ *  The MC graph is traversed once top-down, starting from every PDG 25
+ *  particle in the graph (also those outside of the MC collection that are
+ *  only reached through parent links), and all descendants are marked in a
+ *  flat bitset. The reco->MC relation collection is read once per event.
+ *  Afterwards, each PFO query is a lookup in an open-addressing table (see
+ *  PointerIndex) plus a bit test. The total cost
+ *  per event is linear in the number of MC particles plus PFOs.
+ *
+ *  All buffers are kept between events, so that after the first few events no
+ *  further allocations are needed.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _HIGGS_DESCENDANT_INDEX_H_
+#define _HIGGS_DESCENDANT_INDEX_H_
+// -- C++ STL headers.
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// -- LCIO headers.
+#include "EVENT/LCCollection.h"
+#include "EVENT/LCEvent.h"
+#include "EVENT/MCParticle.h"
+#include "EVENT/ReconstructedParticle.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "mc_graph.h"
+#include "pointer_index.h"
+
+class HiggsDescendantIndex {
+ public:
+  enum class BuildStatus { kOk, kMissingMcCollection, kMissingRelationCollection };
+
+  // Resets the index and fills it for the given event. The MC graph is built
+  // here, too.
+  BuildStatus build(EVENT::LCEvent* event,
+                    const std::string& mc_collection_name,
+                    const std::string& relation_collection_name);
+  // For callers that have built the MC graph of the event already.
+  void build(const McGraph& graph, const EVENT::LCCollection* relations);
+  // Only the Higgs descendants, for PFO->MC links that are MC graph indices
+  // already (e.g. in a skim file). Query with isFromHiggs(int).
+  void build(const McGraph& graph);
+
+  // Whether the PFO has at least one related MCParticle.
+  bool hasMcLink(const EVENT::ReconstructedParticle* rp) const {
+    return reco_to_mc_.find(rp) != nullptr;
+  }
+  // Whether the (first) MCParticle related to the PFO is a Higgs descendant.
+  bool isFromHiggs(const EVENT::ReconstructedParticle* rp) const {
+    const int* mc_index = reco_to_mc_.find(rp);
+    return mc_index && isFromHiggs(*mc_index);
+  }
+  // By MC graph index. -1 (not in the graph) is never a Higgs descendant.
+  bool isFromHiggs(int mc_index) const {
+    if (mc_index < 0) return false;
+    return (descendant_bits_[mc_index >> 6] >> (mc_index & 63)) & 1u;
+  }
+
+  const McGraph& graph() const { return *graph_; }
+  int nHiggsDescendants() const { return n_descendants_; }
+  // Daughter links followed in the top-down pass.
+  int nVisited() const { return n_visited_; }
+  // Generations between the Higgs and its deepest descendant (as first
+  // reached in the pass).
+  int maxDepth() const { return max_depth_; }
+
+ private:
+  void markHiggsDescendants(int higgs_index);
+  void setBit(int i) {
+    descendant_bits_[i >> 6] |= uint64_t(1) << (i & 63);
+  }
+
+  McGraph own_graph_{};
+  const McGraph* graph_ = &own_graph_;
+  std::vector<uint64_t> descendant_bits_{};
+  std::vector<std::pair<int, int>> stack_{};  // Index and generation.
+  // -1: The related MCParticle is not in the graph.
+  PointerIndex<EVENT::ReconstructedParticle> reco_to_mc_{};
+  int n_descendants_ = 0;
+  int n_visited_ = 0;
+  int max_depth_ = 0;
+};
+#endif
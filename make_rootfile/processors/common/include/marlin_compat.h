@@ -0,0 +1,54 @@
+/**
+ *  Helpers for the tools that drive processors without the Marlin executable,
+ *  also across the differences between the Marlin versions.
+ *
+ *  Depending on the version, Marlin hands out the steering parameters as raw
+ *  or as shared pointers. In both cases, the processor does not own them: They
+ *  are kept alive by the caller (in Marlin, by the XMLParser).
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _MARLIN_COMPAT_H_
+#define _MARLIN_COMPAT_H_
+// -- C++ STL headers.
+#include <memory>
+#include <string>
+
+// -- Marlin headers.
+#include "marlin/Processor.h"
+#include "marlin/StringParameters.h"
+
+inline marlin::StringParameters* raw(marlin::StringParameters* parameters) {
+  return parameters;
+}
+inline marlin::StringParameters* raw(
+    const std::shared_ptr<marlin::StringParameters>& parameters) {
+  return parameters.get();
+}
+
+inline void setGlobal(marlin::StringParameters*& global,
+    const std::shared_ptr<marlin::StringParameters>& parameters) {
+  global = parameters.get();
+}
+inline void setGlobal(std::shared_ptr<marlin::StringParameters>& global,
+    const std::shared_ptr<marlin::StringParameters>& parameters) {
+  global = parameters;
+}
+inline void setGlobal(marlin::StringParameters*& global,
+                      marlin::StringParameters* parameters) {
+  global = parameters;
+}
+// Names a processor made with newProcessor(), as Marlin's ProcessorMgr does.
+// Processor::setName() is protected, but a derived class may take a member
+// pointer to it. The processors key their shared state on name() (e.g.
+// PerfRecorder, Diagnostics), so the clones need their steering name.
+inline void setProcessorName(marlin::Processor* processor,
+                             const std::string& name) {
+  struct Namer : marlin::Processor {
+    static void set(marlin::Processor* processor, const std::string& name) {
+      (processor->*(&Namer::setName))(name);
+    }
+  };
+  Namer::set(processor, name);
+}
+#endif
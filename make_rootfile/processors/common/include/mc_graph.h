@@ -0,0 +1,126 @@
+/**
+ *  Flattened, index-based view of the MCParticle graph of one event.
+ *
+ *  The MCParticle collection is copied once per event into structure-of-arrays
+ *  form: PDG and generator status are plain int arrays, daughters and parents
+ *  are stored as compressed sparse rows (an offset array plus one flat index
+ *  array each). Traversals then work on int indices instead of chasing
+ *  MCParticle pointers and copying the std::vectors behind getDaughters().
+ *
+ *  A visited-epoch array replaces per-traversal sets: newEpoch() invalidates
+ *  all marks in O(1).
+ *
+ *  The first nCollectionElements() indices are the collection elements, in
+ *  collection order. Daughters or parents that are not part of the collection
+ *  are appended after them.
+ *
+ *  Instead of building it, the graph can also view the flat arrays of an event
+ *  in a skim file (see skim_file.h) without copying them.
+ *
+ *  All buffers (including the MCParticle -> index table and the visited
+ *  marks) keep their capacity between events, so that after the first few
+ *  events no allocation is needed.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _MC_GRAPH_H_
+#define _MC_GRAPH_H_
+// -- C++ STL headers.
+#include <cstdint>
+#include <vector>
+
+// -- LCIO headers.
+#include "EVENT/LCCollection.h"
+#include "EVENT/MCParticle.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "pointer_index.h"
+
+class McGraph {
+ public:
+  // The flat arrays of the graph.
+  struct Arrays {
+    int size = 0;
+    int n_collection = 0;
+    const int* pdg = nullptr;
+    const int* generator_status = nullptr;
+    const int* daughter_offsets = nullptr;  // size + 1 entries.
+    const int* daughters = nullptr;
+    const int* parent_offsets = nullptr;  // size + 1 entries.
+    const int* parents = nullptr;
+  };
+
+  // Rebuilds the graph from an MCParticle collection.
+  void build(const EVENT::LCCollection* mc_collection);
+  // Views external arrays, which must outlive the view. Without the
+  // MCParticles: particle() is null and indexOf() is -1.
+  void view(const Arrays& arrays);
+  const Arrays& arrays() const { return arrays_; }
+
+  int size() const { return arrays_.size; }
+  int nCollectionElements() const { return arrays_.n_collection; }
+  int pdg(int i) const { return arrays_.pdg[i]; }
+  int absPdg(int i) const {
+    return arrays_.pdg[i] < 0 ? -arrays_.pdg[i] : arrays_.pdg[i];
+  }
+  int generatorStatus(int i) const { return arrays_.generator_status[i]; }
+  const EVENT::MCParticle* particle(int i) const {
+    return particles_.empty() ? nullptr : particles_[i];
+  }
+  // -1 if the particle is not part of the graph.
+  int indexOf(const EVENT::MCParticle* mcp) const {
+    const int* index = index_.find(mcp);
+    return index ? *index : -1;
+  }
+
+  int nDaughters(int i) const {
+    return arrays_.daughter_offsets[i + 1] - arrays_.daughter_offsets[i];
+  }
+  const int* daughtersBegin(int i) const {
+    return arrays_.daughters + arrays_.daughter_offsets[i];
+  }
+  const int* daughtersEnd(int i) const {
+    return arrays_.daughters + arrays_.daughter_offsets[i + 1];
+  }
+  int nParents(int i) const {
+    return arrays_.parent_offsets[i + 1] - arrays_.parent_offsets[i];
+  }
+  const int* parentsBegin(int i) const {
+    return arrays_.parents + arrays_.parent_offsets[i];
+  }
+  const int* parentsEnd(int i) const {
+    return arrays_.parents + arrays_.parent_offsets[i + 1];
+  }
+
+  // Visited marks, valid until the next call of newEpoch() or build().
+  void newEpoch();
+  bool isVisited(int i) const { return visited_epoch_[i] == epoch_; }
+  // Marks the particle. Returns false if it was already marked.
+  bool visit(int i) {
+    if (visited_epoch_[i] == epoch_) return false;
+    visited_epoch_[i] = epoch_;
+    return true;
+  }
+
+ private:
+  int addParticle(const EVENT::MCParticle* mcp);
+  // Grows the visited marks to the graph size and starts a new epoch.
+  void resetVisited();
+
+  // Of the own buffers below (build) or of external arrays (view).
+  Arrays arrays_{};
+
+  std::vector<const EVENT::MCParticle*> particles_{};
+  PointerIndex<EVENT::MCParticle> index_{};
+
+  std::vector<int> pdg_{};
+  std::vector<int> generator_status_{};
+  std::vector<int> daughter_offsets_{};
+  std::vector<int> daughters_{};
+  std::vector<int> parent_offsets_{};
+  std::vector<int> parents_{};
+
+  std::vector<uint32_t> visited_epoch_{};
+  uint32_t epoch_ = 0;
+};
+#endif
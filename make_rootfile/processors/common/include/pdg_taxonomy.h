@@ -0,0 +1,91 @@
+/**
+ *  Particle taxonomy by PDG code, shared by both processors.
+ *
+ *  The category flags of each |PDG| below kTableSize are computed by the
+ *  compiler into one dense table. A classification is a single table load:
+ *
+ *    if (pdg::is(mc_pdg, pdg::kInvisible)) ...
+ *    if (pdg::flags(mc_pdg) & (pdg::kLepton | pdg::kGamma)) ...
+ *
+ *  Codes outside the table (e.g. nuclei, SUSY particles) have no flags.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _PDG_TAXONOMY_H_
+#define _PDG_TAXONOMY_H_
+// -- C++ STL headers.
+#include <cstdint>
+
+namespace pdg {
+
+const int kElectron = 11;
+const int kMuon = 13;
+const int kTau = 15;
+const int kPhoton = 22;
+const int kZ = 23;
+const int kW = 24;
+const int kHiggs = 25;
+const int kHadronizationMarker = 94;  // Whizard/Pythia string or cluster.
+
+enum Flag : uint8_t {
+  kJetForming = 1 << 0,  // Quarks and gluons.
+  kInvisible = 1 << 1,  // Neutrinos.
+  kChargedHadron = 1 << 2,  // As reconstructed by Pandora.
+  kNeutralHadron = 1 << 3,  // As reconstructed by Pandora.
+  kLepton = 1 << 4,  // Charged leptons and neutrinos.
+  kChargedLepton = 1 << 5,
+  kGamma = 1 << 6,
+  kHadronization = 1 << 7,
+};
+
+const int kTableSize = 4096;  // Larger than |PDG| of all flagged particles.
+
+// Only used to fill the table.
+constexpr uint8_t computeFlags(int abs_pdg) {
+  return ((abs_pdg >= 1 && abs_pdg <= 6) || abs_pdg == 21) ? kJetForming
+    : (abs_pdg == 12 || abs_pdg == 14 || abs_pdg == 16) ? kLepton | kInvisible
+    : (abs_pdg == kElectron || abs_pdg == kMuon || abs_pdg == kTau)
+      ? kLepton | kChargedLepton
+    : abs_pdg == kPhoton ? kGamma
+    : (abs_pdg == 211 || abs_pdg == 321 || abs_pdg == 2212) ? kChargedHadron
+    : (abs_pdg == 130 || abs_pdg == 310 || abs_pdg == 2112 || abs_pdg == 3122)
+      ? kNeutralHadron
+    : abs_pdg == kHadronizationMarker ? kHadronization
+    : 0;
+}
+
+namespace detail {
+// C++11 has no std::make_integer_sequence. This one halves N on each level,
+// which keeps the template recursion shallow.
+template <int... I> struct Indices {};
+template <typename A, typename B> struct Concat;
+template <int... I, int... J>
+struct Concat<Indices<I...>, Indices<J...>> {
+  typedef Indices<I..., (sizeof...(I) + J)...> type;
+};
+template <int N> struct MakeIndices {
+  typedef typename Concat<typename MakeIndices<N / 2>::type,
+                          typename MakeIndices<N - N / 2>::type>::type type;
+};
+template <> struct MakeIndices<0> { typedef Indices<> type; };
+template <> struct MakeIndices<1> { typedef Indices<0> type; };
+
+template <int... I> struct FlagTableOf {
+  static constexpr uint8_t flags[sizeof...(I)] = {computeFlags(I)...};
+};
+template <int... I>
+constexpr uint8_t FlagTableOf<I...>::flags[sizeof...(I)];
+
+template <int... I> FlagTableOf<I...> flagTableOf(Indices<I...>);
+typedef decltype(flagTableOf(MakeIndices<kTableSize>::type())) FlagTable;
+}  // namespace detail
+
+inline uint8_t flags(int pdg) {
+  unsigned abs_pdg = pdg < 0 ? -pdg : pdg;
+  return abs_pdg < unsigned(kTableSize) ? detail::FlagTable::flags[abs_pdg] : 0;
+}
+
+inline bool is(int pdg, Flag flag) { return (flags(pdg) & flag) != 0; }
+
+}  // namespace pdg
+#endif
@@ -0,0 +1,124 @@
+/**
+ *  Low-overhead per-stage timing and counters of the processors.
+ *
+ *  Each processor instance (and each clone in the multi-threaded mode) owns
+ *  one recorder. A Scope measures the wall time (steady clock) and the CPU
+ *  time of the current thread spent in one stage of the event processing,
+ *  about 100 ns per scope. Stages and counters are summed per event, and per
+ *  event the maxima are kept.
+ *
+ *  All recorders of the process are known to writeTrees(), which adds two
+ *  trees to a rootfile, summed over the clones of each processor:
+ *    - perf: One row per processor and stage.
+ *    - metadata: One row per processor with the event throughput and the
+ *      counters.
+ *  Since these rows cover all processors of the job, only the first call
+ *  writes them, i.e. into the first output file that is closed. Summing the
+ *  trees over the outputs of several jobs then counts each job once.
+ *  A processor without a recorder (recorder == nullptr) is not measured.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _PERF_RECORDER_H_
+#define _PERF_RECORDER_H_
+// -- C++ STL headers.
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class PerfRecorder {
+ public:
+  enum Stage {
+    kCollectionFetch,
+    kNavigatorBuild,  // MC graph, Higgs descendant index and relations.
+    kAncestrySearch,  // Matching the PFOs to the Higgs descendants.
+    kTruthExtraction,
+    kKinematics,
+    kTreeFill,
+    kNStages
+  };
+  enum Counter {
+    kPfos,
+    kMcVisited,
+    kAncestryDepth,  // Only the maximum per event is meaningful.
+    kNCounters
+  };
+  static const char* stageName(Stage stage);
+  static const char* counterName(Counter counter);
+
+  // Creates a recorder that writeTrees() knows about.
+  static std::shared_ptr<PerfRecorder> create(const std::string& processor);
+  // Adds the perf and metadata trees of all living recorders to the file.
+  // Only once per process, later calls do nothing.
+  static void writeTrees(const std::string& file_name);
+
+  class Scope {
+   public:
+    Scope(PerfRecorder* recorder, Stage stage);
+    ~Scope();
+    Scope(const Scope&) = delete;
+    Scope& operator=(const Scope&) = delete;
+
+   private:
+    PerfRecorder* recorder_;
+    Stage stage_;
+    std::chrono::steady_clock::time_point wall_start_{};
+    double cpu_start_ = 0;
+  };
+
+  // Brackets one processEvent call.
+  class EventScope {
+   public:
+    explicit EventScope(PerfRecorder* recorder) : recorder_(recorder) {
+      if (recorder_) recorder_->beginEvent();
+    }
+    ~EventScope() { if (recorder_) recorder_->endEvent(); }
+    EventScope(const EventScope&) = delete;
+    EventScope& operator=(const EventScope&) = delete;
+
+   private:
+    PerfRecorder* recorder_;
+  };
+
+  void beginEvent();
+  void endEvent();
+  void count(Counter counter, long n) { event_counters_[counter] += n; }
+  void countMax(Counter counter, long n) {
+    if (n > event_counters_[counter]) event_counters_[counter] = n;
+  }
+
+ private:
+  explicit PerfRecorder(const std::string& processor) : processor_(processor) {}
+  static double threadCpuSeconds();
+  void add(Stage stage, double wall, double cpu) {
+    event_wall_[stage] += wall;
+    event_cpu_[stage] += cpu;
+  }
+
+  struct Totals {
+    long n_events = 0;
+    double wall[kNStages] = {};
+    double cpu[kNStages] = {};
+    double max_event_wall[kNStages] = {};
+    double event_wall = 0;  // All of processEvent.
+    double event_cpu = 0;
+    long counters[kNCounters] = {};
+    long max_counters[kNCounters] = {};
+    void add(const Totals& other);
+  };
+
+  static std::mutex registry_mutex_;
+  static std::vector<std::weak_ptr<PerfRecorder>> registry_;
+  static bool has_written_trees_;
+
+  std::string processor_;
+  Totals totals_{};
+  double event_wall_[kNStages] = {};
+  double event_cpu_[kNStages] = {};
+  long event_counters_[kNCounters] = {};
+  std::chrono::steady_clock::time_point event_wall_start_{};
+  double event_cpu_start_ = 0;
+};
+#endif
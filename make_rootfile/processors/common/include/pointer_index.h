@@ -0,0 +1,93 @@
+/**
+ *  Map from object pointers to int values for the per-event lookups (e.g.
+ *  MCParticle -> MC graph index).
+ *
+ *  Open addressing with linear probing in a power-of-two table, at most half
+ *  full. clear() only advances a generation counter: Slots of older
+ *  generations count as empty. The table keeps its capacity, so that after
+ *  the first few events no allocation is needed.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _POINTER_INDEX_H_
+#define _POINTER_INDEX_H_
+// -- C++ STL headers.
+#include <cstdint>
+#include <vector>
+
+template <typename T>
+class PointerIndex {
+ public:
+  void clear() {
+    size_ = 0;
+    if (++generation_ == 0) {
+      for (Slot& slot : slots_) slot.generation = 0;
+      generation_ = 1;
+    }
+  }
+
+  void reserve(std::size_t n) {
+    if (2 * n > slots_.size()) rehash(2 * n);
+  }
+
+  // Null if the key is not in the index.
+  const int* find(const T* key) const {
+    if (slots_.empty()) return nullptr;
+    for (std::size_t i = home(key); ; i = (i + 1) & mask_) {
+      const Slot& slot = slots_[i];
+      if (slot.generation != generation_) return nullptr;
+      if (slot.key == key) return &slot.value;
+    }
+  }
+
+  // Does not overwrite: False if the key is in the index already.
+  bool insert(const T* key, int value) {
+    if (2 * (size_ + 1) > slots_.size()) rehash(2 * (size_ + 1));
+    for (std::size_t i = home(key); ; i = (i + 1) & mask_) {
+      Slot& slot = slots_[i];
+      if (slot.generation != generation_) {
+        slot = Slot{key, value, generation_};
+        ++size_;
+        return true;
+      }
+      if (slot.key == key) return false;
+    }
+  }
+
+  std::size_t size() const { return size_; }
+
+ private:
+  struct Slot {
+    const T* key;
+    int value;
+    uint32_t generation;
+  };
+
+  std::size_t home(const T* key) const {
+    uint64_t h = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(key))
+      * 0x9e3779b97f4a7c15ULL;
+    return static_cast<std::size_t>(h ^ (h >> 32)) & mask_;
+  }
+
+  // To at least n slots, keeping the entries of the current generation.
+  void rehash(std::size_t n) {
+    std::size_t capacity = 64;
+    while (capacity < n) capacity *= 2;
+    std::vector<Slot> old;
+    old.swap(slots_);
+    slots_.assign(capacity, Slot{nullptr, 0, 0});
+    mask_ = capacity - 1;
+    uint32_t old_generation = generation_;
+    generation_ = 1;
+    size_ = 0;
+    for (const Slot& slot : old) {
+      if (slot.generation == old_generation) insert(slot.key, slot.value);
+    }
+  }
+
+  std::vector<Slot> slots_{};
+  std::size_t mask_ = 0;
+  std::size_t size_ = 0;
+  uint32_t generation_ = 1;
+};
+#endif
@@ -0,0 +1,95 @@
+/**
+ *  Compact, memory-mapped skim of the event content that the truth and
+ *  overlay-removal algorithms need, for repeated passes without LCIO.
+ *
+ *  Per event, a skim file holds the flat MC graph (the McGraph arrays), the
+ *  four-vectors and types of the PFOs and, per PFO, the MC graph index of its
+ *  (first) related MCParticle. The layout is fixed, in native byte order:
+ *    - File header: Magic, version, number of events and the position of the
+ *      event table.
+ *    - Per event, 8-byte aligned: An EventHeader with the array sizes, then
+ *      the int arrays pdg, generator status, daughter offsets, daughters,
+ *      parent offsets and parents, then the float arrays px, py, pz and E and
+ *      the int arrays type and MC index (-1: No link) of the PFOs.
+ *    - Event table: The file offset of each event.
+ *  SkimReader maps the whole file. An event is a set of views into the
+ *  mapping (nothing is copied or decoded), e.g. for McGraph::view.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _SKIM_FILE_H_
+#define _SKIM_FILE_H_
+// -- C++ STL headers.
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// -- Header for this processor and other project-specific headers.
+#include "mc_graph.h"
+
+// Read-only view of an array (an aggregate: {data, size}).
+template <typename T>
+struct Span {
+  const T* data;
+  int size;
+  const T* begin() const { return data; }
+  const T* end() const { return data + size; }
+  const T& operator[](int i) const { return data[i]; }
+};
+
+struct SkimEvent {
+  int run = 0;
+  int event = 0;
+  McGraph::Arrays mc{};
+  Span<float> px{};
+  Span<float> py{};
+  Span<float> pz{};
+  Span<float> e{};
+  Span<int> type{};
+  Span<int> mc_index{};  // Into the MC graph, -1: No related MCParticle.
+  int nPfos() const { return type.size; }
+};
+
+class SkimWriter {
+ public:
+  // Throws std::runtime_error if the file cannot be created.
+  explicit SkimWriter(const std::string& file_name);
+  SkimWriter(const SkimWriter&) = delete;
+  SkimWriter& operator=(const SkimWriter&) = delete;
+
+  void write(const SkimEvent& event);
+  // Writes the event table. Without it, the file is not readable.
+  void close();
+  long nEvents() const { return static_cast<long>(offsets_.size()); }
+
+ private:
+  template <typename T>
+  void writeArray(const T* data, int size);
+  void pad();
+
+  std::string file_name_;
+  std::ofstream file_;
+  uint64_t position_ = 0;
+  std::vector<uint64_t> offsets_{};
+};
+
+class SkimReader {
+ public:
+  // Throws std::runtime_error if the file cannot be mapped or is no skim file.
+  explicit SkimReader(const std::string& file_name);
+  ~SkimReader();
+  SkimReader(const SkimReader&) = delete;
+  SkimReader& operator=(const SkimReader&) = delete;
+
+  long nEvents() const { return n_events_; }
+  // Valid as long as the reader exists.
+  SkimEvent event(long i) const;
+
+ private:
+  const char* data_ = nullptr;
+  std::size_t size_ = 0;
+  const uint64_t* offsets_ = nullptr;
+  long n_events_ = 0;
+};
+#endif
@@ -0,0 +1,112 @@
+/**
+ *  Sidecar cache of the MC truth results, keyed by run and event number.
+ *
+ *  The Higgs origin of each PFO and the Higgs truth variables only depend on
+ *  the MC content of an event. With a cache file, a rerun that only changes
+ *  reco-level variables skips the MC traversals:
+ *    - Per event, the cache holds a bitmask over the PFO collection (bit i:
+ *      PFO i stems from the Higgs) and the HiggsTruth fields.
+ *    - The file records the collection names that its content was made from:
+ *      The MC collection (the mc key, for everything) and the PFO and relation
+ *      collections (the pfo key, for the bitmasks). A file with another mc key
+ *      is ignored, with another pfo key only its bitmasks are dropped.
+ *    - An entry is only used if the sizes of the MC (and PFO) collection
+ *      match those at the time of filling.
+ *    - Missing entries are filled during the run. If anything was added, the
+ *      file is rewritten when the last user releases the cache: Into a
+ *      temporary file that is then renamed, so that the cache file is always
+ *      complete. Separate jobs (e.g. of vvh_runner) that share a cache file do
+ *      not merge their entries, the last one to finish replaces the file.
+ *
+ *  All processors (and their clones in the multi-threaded mode) with the same
+ *  cache file share one instance. The file is read completely on open().
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _TRUTH_CACHE_H_
+#define _TRUTH_CACHE_H_
+// -- C++ STL headers.
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class TruthCache {
+ public:
+  struct Truth {
+    int decays_invisible = 0;
+    int decay_mode = -1;
+    int n_jets = -1;
+  };
+
+  // The mc key names the MC collection, the pfo key the PFO and relation
+  // collections of the PFO origins (empty if the caller only uses the Higgs
+  // truth, see pfoKey()). Null if the cache file is already shared by
+  // processors with other keys.
+  static std::shared_ptr<TruthCache> open(const std::string& file_name,
+                                          const std::string& mc_key,
+                                          const std::string& pfo_key);
+  static std::string pfoKey(const std::string& pfo_collection,
+                            const std::string& relation_collection) {
+    return pfo_collection + "/" + relation_collection;
+  }
+  ~TruthCache();
+  TruthCache(const TruthCache&) = delete;
+  TruthCache& operator=(const TruthCache&) = delete;
+
+  // False if the event is not cached or the cached entry does not match.
+  bool findTruth(int run, int event, int n_mc, Truth& truth) const;
+  bool findPfoOrigin(int run, int event, int n_mc, int n_pfos,
+                     std::vector<uint64_t>& pfo_origin) const;
+  void storeTruth(int run, int event, int n_mc, const Truth& truth);
+  void storePfoOrigin(int run, int event, int n_mc, int n_pfos,
+                      const std::vector<uint64_t>& pfo_origin);
+
+  int nEntries() const;
+
+  // The PFO origin bitmask.
+  static void resetMask(std::vector<uint64_t>& mask, int n_pfos) {
+    mask.assign((n_pfos + 63) / 64, 0);
+  }
+  static void setBit(std::vector<uint64_t>& mask, int i) {
+    mask[i >> 6] |= uint64_t(1) << (i & 63);
+  }
+  static bool testBit(const std::vector<uint64_t>& mask, int i) {
+    return (mask[i >> 6] >> (i & 63)) & 1u;
+  }
+
+ private:
+  struct Entry {
+    int n_mc = -1;
+    int n_pfos = -1;  // -1: No PFO origin cached.
+    std::vector<uint64_t> pfo_origin{};
+    bool has_truth = false;
+    Truth truth{};
+  };
+  TruthCache(const std::string& file_name, const std::string& mc_key)
+    : file_name_(file_name), mc_key_(mc_key) {}
+  static uint64_t eventKey(int run, int event) {
+    return (uint64_t(uint32_t(run)) << 32) | uint32_t(event);
+  }
+  // The entry for the event, reset if its MC content does not match.
+  Entry& entryFor(int run, int event, int n_mc);
+  // False if the cache has PFO origins of another pfo key already.
+  bool bindPfoKey(const std::string& pfo_key);
+  void read();
+  void write() const;
+
+  static std::mutex registry_mutex_;
+  static std::map<std::string, std::weak_ptr<TruthCache>> registry_;
+
+  mutable std::mutex mutex_{};
+  std::string file_name_;
+  std::string mc_key_;
+  std::string pfo_key_{""};  // Of the PFO origins in entries_.
+  bool has_pfo_user_ = false;  // A processor with a pfo key has opened it.
+  std::unordered_map<uint64_t, Entry> entries_{};
+  bool modified_ = false;
+};
+#endif
@@ -0,0 +1,120 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <algorithm>
+#include <climits>
+#include <iomanip>
+#include <vector>
+
+// -- Marlin headers.
+#include "streamlog/streamlog.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "diagnostics.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+const int Diagnostics::kEmptySlot = INT_MIN;
+
+std::mutex Diagnostics::registry_mutex_;
+std::map<std::string, std::weak_ptr<Diagnostics>> Diagnostics::registry_;
+
+// ----------------------------------------------------------------------------
+const char* Diagnostics::kindName(Kind kind) {
+  switch (kind) {
+    case kPfoWithoutMcLink: return "pfo_without_mc_link";
+    case kUnexpectedPfoPdg: return "unexpected_pfo_pdg";
+    case kUnforeseenHiggsDecay: return "unforeseen_higgs_decay";
+    case kUnresolvedTauDecay: return "unresolved_tau_decay";
+    case kStableWithoutJet: return "stable_without_jet";
+    default: return "unknown";
+  }
+}
+
+std::shared_ptr<Diagnostics> Diagnostics::open(const std::string& processor,
+                                               int n_examples) {
+  std::lock_guard<std::mutex> registry_lock(registry_mutex_);
+  std::shared_ptr<Diagnostics> diagnostics = registry_[processor].lock();
+  if (!diagnostics) {
+    diagnostics.reset(new Diagnostics(processor, n_examples));
+    registry_[processor] = diagnostics;
+  }
+  return diagnostics;
+}
+
+Diagnostics::Diagnostics(const std::string& processor, int n_examples)
+    : processor_(processor), n_examples_(n_examples) {
+  n_prescale_seen_.store(0);
+  n_prescale_kept_.store(0);
+  for (int k = 0; k < kNKinds; ++k) {
+    n_reported_[k].store(0);
+    n_overflow_[k].store(0);
+    for (int s = 0; s < kNSlots; ++s) {
+      pdg_[k][s].store(kEmptySlot);
+      n_per_pdg_[k][s].store(0);
+    }
+  }
+}
+
+Diagnostics::~Diagnostics() {
+  logSummary();
+}
+
+// ----------------------------------------------------------------------------
+void Diagnostics::count(Kind kind, int pdg) {
+  // Open addressing with linear probing. A slot, once claimed, keeps its PDG.
+  unsigned start = static_cast<unsigned>(pdg) * 2654435761u % kNSlots;
+  for (int probe = 0; probe < kNSlots; ++probe) {
+    int slot = (start + probe) % kNSlots;
+    int slot_pdg = pdg_[kind][slot].load(std::memory_order_relaxed);
+    if (slot_pdg == kEmptySlot) {
+      // On failure, slot_pdg holds the PDG that another thread claimed.
+      pdg_[kind][slot].compare_exchange_strong(slot_pdg, pdg,
+                                               std::memory_order_relaxed);
+      if (slot_pdg == kEmptySlot) slot_pdg = pdg;
+    }
+    if (slot_pdg == pdg) {
+      n_per_pdg_[kind][slot].fetch_add(1, std::memory_order_relaxed);
+      return;
+    }
+  }
+  n_overflow_[kind].fetch_add(1, std::memory_order_relaxed);
+}
+
+void Diagnostics::logSummary() const {
+  if (n_prescale_seen_.load() > 0) {
+    streamlog_out(MESSAGE) << processor_ << ": Prescaled decay modes: Kept "
+      << n_prescale_kept_.load() << " of " << n_prescale_seen_.load()
+      << " events." << std::endl;
+  }
+  struct Row {
+    long n;
+    int pdg;
+  };
+  for (int k = 0; k < kNKinds; ++k) {
+    long n_reported = n_reported_[k].load();
+    if (n_reported == 0) continue;
+    std::vector<Row> rows;
+    for (int s = 0; s < kNSlots; ++s) {
+      if (pdg_[k][s].load() != kEmptySlot) {
+        rows.push_back({n_per_pdg_[k][s].load(), pdg_[k][s].load()});
+      }
+    }
+    std::sort(rows.begin(), rows.end(),
+              [](const Row& a, const Row& b) { return a.n > b.n; });
+    streamlog_out(WARNING) << processor_ << ": " << n_reported << " x "
+      << kindName(static_cast<Kind>(k)) << " (the first "
+      << std::min<long>(n_reported, n_examples_) << " logged)." << std::endl;
+    streamlog_out(WARNING) << std::setw(12) << "pdg" << std::setw(12) << "count"
+      << std::endl;
+    for (const Row& row : rows) {
+      streamlog_out(WARNING) << std::setw(12) << row.pdg << std::setw(12)
+        << row.n << std::endl;
+    }
+    if (n_overflow_[k].load() > 0) {
+      streamlog_out(WARNING) << std::setw(12) << "other" << std::setw(12)
+        << n_overflow_[k].load() << std::endl;
+    }
+  }
+}
@@ -0,0 +1,98 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+
+// -- LCIO headers.
+#include "EVENT/LCRelation.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "higgs_descendant_index.h"
+#include "pdg_taxonomy.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+using RP = EVENT::ReconstructedParticle;
+using MCP = EVENT::MCParticle;
+
+// ----------------------------------------------------------------------------
+HiggsDescendantIndex::BuildStatus HiggsDescendantIndex::build(
+    EVENT::LCEvent* event,
+    const std::string& mc_collection_name,
+    const std::string& relation_collection_name) {
+  // clear() keeps the capacity (and the table slots) from previous events.
+  graph_ = &own_graph_;
+  descendant_bits_.clear();
+  reco_to_mc_.clear();
+  n_descendants_ = 0;
+  n_visited_ = 0;
+  max_depth_ = 0;
+
+  EVENT::LCCollection* mc_collection = nullptr;
+  EVENT::LCCollection* relation_collection = nullptr;
+  try {
+    mc_collection = event->getCollection(mc_collection_name);
+  } catch (EVENT::DataNotAvailableException &e) {
+    return BuildStatus::kMissingMcCollection;
+  }
+  try {
+    relation_collection = event->getCollection(relation_collection_name);
+  } catch (EVENT::DataNotAvailableException &e) {
+    return BuildStatus::kMissingRelationCollection;
+  }
+  own_graph_.build(mc_collection);
+  build(own_graph_, relation_collection);
+  return BuildStatus::kOk;
+}
+
+void HiggsDescendantIndex::build(const McGraph& graph,
+                                 const EVENT::LCCollection* relations) {
+  build(graph);
+  int n_relations = relations->getNumberOfElements();
+  reco_to_mc_.reserve(n_relations);
+  for (int i = 0; i < n_relations; ++i) {
+    auto relation = static_cast<EVENT::LCRelation*>(relations->getElementAt(i));
+    auto rp = dynamic_cast<const RP*>(relation->getFrom());
+    auto mcp = dynamic_cast<const MCP*>(relation->getTo());
+    if (!rp || !mcp) continue;
+    // Only the first relation of a PFO is used, as in the navigator-based
+    // search before. insert() does not overwrite an existing entry.
+    reco_to_mc_.insert(rp, graph.indexOf(mcp));
+  }
+}
+
+void HiggsDescendantIndex::build(const McGraph& graph) {
+  graph_ = &graph;
+  descendant_bits_.assign((graph.size() + 63) / 64, 0);
+  reco_to_mc_.clear();
+  n_descendants_ = 0;
+  n_visited_ = 0;
+  max_depth_ = 0;
+
+  // All particles of the graph are seeds, as in the parent walk-up: A Higgs
+  // outside of the collection may only be reachable through parent links.
+  for (int i = 0; i < graph.size(); ++i) {
+    if (graph.pdg(i) == pdg::kHiggs) markHiggsDescendants(i);
+  }
+}
+
+void HiggsDescendantIndex::markHiggsDescendants(int higgs_index) {
+  const McGraph& graph = *graph_;
+  stack_.clear();
+  stack_.push_back({higgs_index, 0});
+  while (!stack_.empty()) {
+    int mcp = stack_.back().first;
+    int depth = stack_.back().second + 1;
+    stack_.pop_back();
+    for (const int* d = graph.daughtersBegin(mcp);
+         d != graph.daughtersEnd(mcp); ++d) {
+      ++n_visited_;
+      // Everything below an already marked particle is marked, too.
+      if (isFromHiggs(*d)) continue;
+      setBit(*d);
+      ++n_descendants_;
+      if (depth > max_depth_) max_depth_ = depth;
+      stack_.push_back({*d, depth});
+    }
+  }
+}
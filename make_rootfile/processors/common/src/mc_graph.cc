@@ -0,0 +1,87 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <algorithm>
+
+// -- Header for this processor and other project-specific headers.
+#include "mc_graph.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+using MCP = EVENT::MCParticle;
+
+// ----------------------------------------------------------------------------
+void McGraph::build(const EVENT::LCCollection* mc_collection) {
+  particles_.clear();
+  index_.clear();
+  pdg_.clear();
+  generator_status_.clear();
+  daughter_offsets_.clear();
+  daughters_.clear();
+  parent_offsets_.clear();
+  parents_.clear();
+
+  const int n_collection = mc_collection->getNumberOfElements();
+  index_.reserve(n_collection);
+  for (int i = 0; i < n_collection; ++i) {
+    addParticle(static_cast<MCP*>(mc_collection->getElementAt(i)));
+  }
+  // Relatives outside of the collection are appended during the loop, and
+  // then get their own rows in turn.
+  daughter_offsets_.push_back(0);
+  parent_offsets_.push_back(0);
+  for (std::size_t i = 0; i < particles_.size(); ++i) {
+    for (const MCP* daughter : particles_[i]->getDaughters()) {
+      daughters_.push_back(addParticle(daughter));
+    }
+    daughter_offsets_.push_back(static_cast<int>(daughters_.size()));
+    for (const MCP* parent : particles_[i]->getParents()) {
+      parents_.push_back(addParticle(parent));
+    }
+    parent_offsets_.push_back(static_cast<int>(parents_.size()));
+  }
+
+  arrays_.size = static_cast<int>(particles_.size());
+  arrays_.n_collection = n_collection;
+  arrays_.pdg = pdg_.data();
+  arrays_.generator_status = generator_status_.data();
+  arrays_.daughter_offsets = daughter_offsets_.data();
+  arrays_.daughters = daughters_.data();
+  arrays_.parent_offsets = parent_offsets_.data();
+  arrays_.parents = parents_.data();
+  resetVisited();
+}
+
+void McGraph::view(const Arrays& arrays) {
+  particles_.clear();
+  index_.clear();
+  arrays_ = arrays;
+  resetVisited();
+}
+
+int McGraph::addParticle(const MCP* mcp) {
+  const int* index = index_.find(mcp);
+  if (index) return *index;
+  const int new_index = static_cast<int>(particles_.size());
+  index_.insert(mcp, new_index);
+  particles_.push_back(mcp);
+  pdg_.push_back(mcp->getPDG());
+  generator_status_.push_back(mcp->getGeneratorStatus());
+  return new_index;
+}
+
+void McGraph::resetVisited() {
+  // Marks beyond the graph size are stale, the new epoch invalidates them.
+  if (visited_epoch_.size() < static_cast<std::size_t>(arrays_.size)) {
+    visited_epoch_.resize(arrays_.size, 0);
+  }
+  newEpoch();
+}
+
+void McGraph::newEpoch() {
+  if (++epoch_ == 0) {
+    std::fill(visited_epoch_.begin(), visited_epoch_.end(), 0);
+    epoch_ = 1;
+  }
+}
@@ -0,0 +1,191 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <algorithm>
+#include <time.h>
+
+// -- ROOT headers.
+#include "TFile.h"
+#include "TTree.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "perf_recorder.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+using SteadyClock = std::chrono::steady_clock;
+
+std::mutex PerfRecorder::registry_mutex_;
+std::vector<std::weak_ptr<PerfRecorder>> PerfRecorder::registry_;
+bool PerfRecorder::has_written_trees_ = false;
+
+// ----------------------------------------------------------------------------
+const char* PerfRecorder::stageName(Stage stage) {
+  switch (stage) {
+    case kCollectionFetch: return "collection_fetch";
+    case kNavigatorBuild: return "navigator_build";
+    case kAncestrySearch: return "ancestry_search";
+    case kTruthExtraction: return "truth_extraction";
+    case kKinematics: return "kinematics";
+    case kTreeFill: return "tree_fill";
+    default: return "unknown";
+  }
+}
+
+const char* PerfRecorder::counterName(Counter counter) {
+  switch (counter) {
+    case kPfos: return "n_pfos";
+    case kMcVisited: return "n_mc_visited";
+    case kAncestryDepth: return "ancestry_depth";
+    default: return "unknown";
+  }
+}
+
+std::shared_ptr<PerfRecorder> PerfRecorder::create(const std::string& processor) {
+  std::shared_ptr<PerfRecorder> recorder(new PerfRecorder(processor));
+  std::lock_guard<std::mutex> lock(registry_mutex_);
+  registry_.push_back(recorder);
+  return recorder;
+}
+
+double PerfRecorder::threadCpuSeconds() {
+  timespec t;
+  clock_gettime(CLOCK_THREAD_CPUTIME_ID, &t);
+  return t.tv_sec + 1e-9 * t.tv_nsec;
+}
+
+// ----------------------------------------------------------------------------
+PerfRecorder::Scope::Scope(PerfRecorder* recorder, Stage stage)
+    : recorder_(recorder), stage_(stage) {
+  if (!recorder_) return;
+  wall_start_ = SteadyClock::now();
+  cpu_start_ = threadCpuSeconds();
+}
+
+PerfRecorder::Scope::~Scope() {
+  if (!recorder_) return;
+  double cpu = threadCpuSeconds() - cpu_start_;
+  std::chrono::duration<double> wall = SteadyClock::now() - wall_start_;
+  recorder_->add(stage_, wall.count(), cpu);
+}
+
+void PerfRecorder::beginEvent() {
+  std::fill(event_wall_, event_wall_ + kNStages, 0);
+  std::fill(event_cpu_, event_cpu_ + kNStages, 0);
+  std::fill(event_counters_, event_counters_ + kNCounters, 0);
+  event_wall_start_ = SteadyClock::now();
+  event_cpu_start_ = threadCpuSeconds();
+}
+
+void PerfRecorder::endEvent() {
+  std::chrono::duration<double> wall = SteadyClock::now() - event_wall_start_;
+  totals_.event_wall += wall.count();
+  totals_.event_cpu += threadCpuSeconds() - event_cpu_start_;
+  totals_.n_events++;
+  for (int s = 0; s < kNStages; ++s) {
+    totals_.wall[s] += event_wall_[s];
+    totals_.cpu[s] += event_cpu_[s];
+    totals_.max_event_wall[s] = std::max(totals_.max_event_wall[s], event_wall_[s]);
+  }
+  for (int c = 0; c < kNCounters; ++c) {
+    totals_.counters[c] += event_counters_[c];
+    totals_.max_counters[c] = std::max(totals_.max_counters[c], event_counters_[c]);
+  }
+}
+
+void PerfRecorder::Totals::add(const Totals& other) {
+  n_events += other.n_events;
+  event_wall += other.event_wall;
+  event_cpu += other.event_cpu;
+  for (int s = 0; s < kNStages; ++s) {
+    wall[s] += other.wall[s];
+    cpu[s] += other.cpu[s];
+    max_event_wall[s] = std::max(max_event_wall[s], other.max_event_wall[s]);
+  }
+  for (int c = 0; c < kNCounters; ++c) {
+    counters[c] += other.counters[c];
+    max_counters[c] = std::max(max_counters[c], other.max_counters[c]);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void PerfRecorder::writeTrees(const std::string& file_name) {
+  // Sum the clones of each processor, in the order of their creation.
+  std::vector<std::string> processors;
+  std::vector<Totals> totals;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex_);
+    if (has_written_trees_) return;
+    has_written_trees_ = true;
+    for (const std::weak_ptr<PerfRecorder>& weak : registry_) {
+      std::shared_ptr<PerfRecorder> recorder = weak.lock();
+      if (!recorder) continue;
+      auto it = std::find(processors.begin(), processors.end(),
+                          recorder->processor_);
+      if (it == processors.end()) {
+        processors.push_back(recorder->processor_);
+        totals.push_back(recorder->totals_);
+      } else {
+        totals[it - processors.begin()].add(recorder->totals_);
+      }
+    }
+  }
+
+  TFile file(file_name.c_str(), "update");
+  std::string processor;
+  std::string stage;
+  Long64_t n_events = 0;
+  double wall_s = 0;
+  double cpu_s = 0;
+  double max_event_wall_us = 0;
+  // The file owns the trees and deletes them in Close().
+  TTree* perf = new TTree("perf", "Time per processor and stage.");
+  perf->Branch("processor", &processor);
+  perf->Branch("stage", &stage);
+  perf->Branch("n_events", &n_events);
+  perf->Branch("wall_s", &wall_s);
+  perf->Branch("cpu_s", &cpu_s);
+  perf->Branch("max_event_wall_us", &max_event_wall_us);
+  for (std::size_t p = 0; p < processors.size(); ++p) {
+    processor = processors[p];
+    n_events = totals[p].n_events;
+    for (int s = 0; s < kNStages; ++s) {
+      stage = stageName(static_cast<Stage>(s));
+      wall_s = totals[p].wall[s];
+      cpu_s = totals[p].cpu[s];
+      max_event_wall_us = 1e6 * totals[p].max_event_wall[s];
+      perf->Fill();
+    }
+  }
+
+  double events_per_s = 0;
+  Long64_t counters[kNCounters];
+  Long64_t max_counters[kNCounters];
+  TTree* metadata = new TTree("metadata", "Throughput and counters per processor.");
+  metadata->Branch("processor", &processor);
+  metadata->Branch("n_events", &n_events);
+  metadata->Branch("wall_s", &wall_s);
+  metadata->Branch("cpu_s", &cpu_s);
+  metadata->Branch("events_per_s", &events_per_s);
+  for (int c = 0; c < kNCounters; ++c) {
+    std::string name = counterName(static_cast<Counter>(c));
+    metadata->Branch((name + "_total").c_str(), &counters[c]);
+    metadata->Branch((name + "_max").c_str(), &max_counters[c]);
+  }
+  for (std::size_t p = 0; p < processors.size(); ++p) {
+    processor = processors[p];
+    n_events = totals[p].n_events;
+    wall_s = totals[p].event_wall;
+    cpu_s = totals[p].event_cpu;
+    events_per_s = wall_s > 0 ? n_events / wall_s : 0;
+    for (int c = 0; c < kNCounters; ++c) {
+      counters[c] = totals[p].counters[c];
+      max_counters[c] = totals[p].max_counters[c];
+    }
+    metadata->Fill();
+  }
+  perf->Write("", TObject::kOverwrite);
+  metadata->Write("", TObject::kOverwrite);
+  file.Close();
+}
@@ -0,0 +1,203 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// -- Header for this processor and other project-specific headers.
+#include "skim_file.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+const char kMagic[8] = "VVHSKIM";
+const uint32_t kVersion = 1;
+
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t reserved;
+  uint64_t n_events;
+  uint64_t table_offset;
+};
+
+struct EventHeader {
+  int32_t run;
+  int32_t event;
+  int32_t n_mc;
+  int32_t n_mc_collection;
+  int32_t n_daughters;
+  int32_t n_parents;
+  int32_t n_pfos;
+  int32_t reserved;
+};
+
+static_assert(sizeof(int) == 4 && sizeof(float) == 4, "Skim array layout.");
+static_assert(sizeof(FileHeader) % 8 == 0 && sizeof(EventHeader) % 8 == 0,
+              "Skim block alignment.");
+
+// Bytes of an event after its header, including the padding.
+uint64_t eventBytes(const EventHeader& h) {
+  uint64_t n_words = 2 * uint64_t(h.n_mc) + 2 * (uint64_t(h.n_mc) + 1)
+    + h.n_daughters + h.n_parents + 6 * uint64_t(h.n_pfos);
+  return (4 * n_words + 7) / 8 * 8;
+}
+
+// ----------------------------------------------------------------------------
+SkimWriter::SkimWriter(const std::string& file_name)
+    : file_name_(file_name),
+      file_(file_name, std::ios::binary | std::ios::trunc) {
+  if (!file_) {
+    throw std::runtime_error("Could not create the skim file " + file_name + ".");
+  }
+  FileHeader header{};  // Completed in close().
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  position_ = sizeof(header);
+}
+
+void SkimWriter::write(const SkimEvent& event) {
+  const McGraph::Arrays& mc = event.mc;
+  EventHeader header{};
+  header.run = event.run;
+  header.event = event.event;
+  header.n_mc = mc.size;
+  header.n_mc_collection = mc.n_collection;
+  header.n_daughters = mc.daughter_offsets ? mc.daughter_offsets[mc.size] : 0;
+  header.n_parents = mc.parent_offsets ? mc.parent_offsets[mc.size] : 0;
+  header.n_pfos = event.nPfos();
+  offsets_.push_back(position_);
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  position_ += sizeof(header);
+
+  // An empty graph still has its leading 0 offsets.
+  const int zero = 0;
+  writeArray(mc.pdg, mc.size);
+  writeArray(mc.generator_status, mc.size);
+  writeArray(mc.daughter_offsets ? mc.daughter_offsets : &zero, mc.size + 1);
+  writeArray(mc.daughters, header.n_daughters);
+  writeArray(mc.parent_offsets ? mc.parent_offsets : &zero, mc.size + 1);
+  writeArray(mc.parents, header.n_parents);
+  writeArray(event.px.data, header.n_pfos);
+  writeArray(event.py.data, header.n_pfos);
+  writeArray(event.pz.data, header.n_pfos);
+  writeArray(event.e.data, header.n_pfos);
+  writeArray(event.type.data, header.n_pfos);
+  writeArray(event.mc_index.data, header.n_pfos);
+  pad();
+  if (!file_) {
+    throw std::runtime_error("Could not write to the skim file " + file_name_ + ".");
+  }
+}
+
+template <typename T>
+void SkimWriter::writeArray(const T* data, int size) {
+  if (size <= 0) return;
+  file_.write(reinterpret_cast<const char*>(data), size * sizeof(T));
+  position_ += size * sizeof(T);
+}
+
+void SkimWriter::pad() {
+  static const char zeros[8] = {};
+  std::size_t n_padding = (8 - position_ % 8) % 8;
+  file_.write(zeros, n_padding);
+  position_ += n_padding;
+}
+
+void SkimWriter::close() {
+  FileHeader header{};
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.n_events = offsets_.size();
+  header.table_offset = position_;
+  writeArray(offsets_.data(), static_cast<int>(offsets_.size()));
+  file_.seekp(0);
+  file_.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file_.close();
+  if (!file_) {
+    throw std::runtime_error("Could not write to the skim file " + file_name_ + ".");
+  }
+}
+
+// ----------------------------------------------------------------------------
+SkimReader::SkimReader(const std::string& file_name) {
+  int fd = ::open(file_name.c_str(), O_RDONLY);
+  struct stat status;
+  if (fd < 0 || ::fstat(fd, &status) != 0) {
+    if (fd >= 0) ::close(fd);
+    throw std::runtime_error("Could not open the skim file " + file_name + ".");
+  }
+  size_ = status.st_size;
+  void* data = size_ > 0
+    ? ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  ::close(fd);  // The mapping stays valid.
+  if (data == MAP_FAILED) {
+    throw std::runtime_error("Could not map the skim file " + file_name + ".");
+  }
+  data_ = static_cast<const char*>(data);
+  // Passes usually run over all events in order.
+  ::madvise(data, size_, MADV_SEQUENTIAL);
+
+  const FileHeader* header = reinterpret_cast<const FileHeader*>(data_);
+  bool is_valid = size_ >= sizeof(FileHeader)
+    && std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0
+    && header->version == kVersion
+    && header->table_offset <= size_
+    && header->n_events <= (size_ - header->table_offset) / sizeof(uint64_t);
+  if (!is_valid) {
+    ::munmap(data, size_);
+    throw std::runtime_error(file_name + " is no (complete) skim file.");
+  }
+  offsets_ = reinterpret_cast<const uint64_t*>(data_ + header->table_offset);
+  n_events_ = static_cast<long>(header->n_events);
+}
+
+SkimReader::~SkimReader() {
+  ::munmap(const_cast<char*>(data_), size_);
+}
+
+SkimEvent SkimReader::event(long i) const {
+  if (offsets_[i] + sizeof(EventHeader) > size_) {
+    throw std::runtime_error("The skim event " + std::to_string(i)
+      + " is truncated.");
+  }
+  const char* begin = data_ + offsets_[i];
+  const EventHeader& header = *reinterpret_cast<const EventHeader*>(begin);
+  if (offsets_[i] + sizeof(EventHeader) + eventBytes(header) > size_) {
+    throw std::runtime_error("The skim event " + std::to_string(i)
+      + " is truncated.");
+  }
+  const int* words = reinterpret_cast<const int*>(begin + sizeof(EventHeader));
+  auto next_ints = [&words](int size) {
+    const int* array = words;
+    words += size;
+    return array;
+  };
+  auto next_floats = [&words](int size) {
+    Span<float> span{reinterpret_cast<const float*>(words), size};
+    words += size;
+    return span;
+  };
+
+  SkimEvent event;
+  event.run = header.run;
+  event.event = header.event;
+  event.mc.size = header.n_mc;
+  event.mc.n_collection = header.n_mc_collection;
+  event.mc.pdg = next_ints(header.n_mc);
+  event.mc.generator_status = next_ints(header.n_mc);
+  event.mc.daughter_offsets = next_ints(header.n_mc + 1);
+  event.mc.daughters = next_ints(header.n_daughters);
+  event.mc.parent_offsets = next_ints(header.n_mc + 1);
+  event.mc.parents = next_ints(header.n_parents);
+  event.px = next_floats(header.n_pfos);
+  event.py = next_floats(header.n_pfos);
+  event.pz = next_floats(header.n_pfos);
+  event.e = next_floats(header.n_pfos);
+  event.type = Span<int>{next_ints(header.n_pfos), header.n_pfos};
+  event.mc_index = Span<int>{next_ints(header.n_pfos), header.n_pfos};
+  return event;
+}
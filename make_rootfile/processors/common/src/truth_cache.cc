@@ -0,0 +1,221 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <algorithm>
+#include <cstdio>
+#include <unistd.h>
+
+// -- ROOT headers.
+#include "TFile.h"
+#include "TNamed.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+// -- Marlin headers.
+#include "streamlog/streamlog.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "truth_cache.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+const char* const kCacheTreeName = "truth_cache";
+const char* const kCacheKeyName = "key";
+const char* const kCachePfoKeyName = "pfo_key";
+
+std::mutex TruthCache::registry_mutex_;
+std::map<std::string, std::weak_ptr<TruthCache>> TruthCache::registry_;
+
+// ----------------------------------------------------------------------------
+std::shared_ptr<TruthCache> TruthCache::open(const std::string& file_name,
+                                             const std::string& mc_key,
+                                             const std::string& pfo_key) {
+  std::lock_guard<std::mutex> registry_lock(registry_mutex_);
+  std::shared_ptr<TruthCache> cache = registry_[file_name].lock();
+  if (!cache) {
+    cache.reset(new TruthCache(file_name, mc_key));
+    cache->read();
+    registry_[file_name] = cache;
+  }
+  if (cache->mc_key_ != mc_key ||
+      (pfo_key != "" && !cache->bindPfoKey(pfo_key))) {
+    streamlog_out(ERROR) << "The truth cache " << file_name << " is already "
+      << "used for other input collections (" << cache->mc_key_ << ", "
+      << cache->pfo_key_ << " vs. " << mc_key << ", " << pfo_key << "). It is "
+      << "not used for these." << std::endl;
+    return nullptr;
+  }
+  return cache;
+}
+
+TruthCache::~TruthCache() {
+  if (modified_) write();
+}
+
+int TruthCache::nEntries() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+// ----------------------------------------------------------------------------
+bool TruthCache::findTruth(int run, int event, int n_mc, Truth& truth) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(eventKey(run, event));
+  if (it == entries_.end() || !it->second.has_truth) return false;
+  if (it->second.n_mc != n_mc) return false;
+  truth = it->second.truth;
+  return true;
+}
+
+bool TruthCache::findPfoOrigin(int run, int event, int n_mc, int n_pfos,
+                               std::vector<uint64_t>& pfo_origin) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto it = entries_.find(eventKey(run, event));
+  if (it == entries_.end() || it->second.n_pfos < 0) return false;
+  if (it->second.n_mc != n_mc || it->second.n_pfos != n_pfos) return false;
+  pfo_origin = it->second.pfo_origin;
+  return true;
+}
+
+TruthCache::Entry& TruthCache::entryFor(int run, int event, int n_mc) {
+  Entry& entry = entries_[eventKey(run, event)];
+  if (entry.n_mc != n_mc) entry = Entry();
+  entry.n_mc = n_mc;
+  return entry;
+}
+
+void TruthCache::storeTruth(int run, int event, int n_mc, const Truth& truth) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entryFor(run, event, n_mc);
+  entry.has_truth = true;
+  entry.truth = truth;
+  modified_ = true;
+}
+
+void TruthCache::storePfoOrigin(int run, int event, int n_mc, int n_pfos,
+                                const std::vector<uint64_t>& pfo_origin) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Entry& entry = entryFor(run, event, n_mc);
+  entry.n_pfos = n_pfos;
+  entry.pfo_origin = pfo_origin;
+  modified_ = true;
+}
+
+bool TruthCache::bindPfoKey(const std::string& pfo_key) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (has_pfo_user_) return pfo_key == pfo_key_;
+  has_pfo_user_ = true;
+  if (pfo_key != pfo_key_) {
+    // Only PFO origins read from the file can exist yet.
+    for (auto& key_entry : entries_) {
+      key_entry.second.n_pfos = -1;
+      key_entry.second.pfo_origin.clear();
+    }
+    pfo_key_ = pfo_key;
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+void TruthCache::read() {
+  if (gSystem->AccessPathName(file_name_.c_str())) {
+    streamlog_out(MESSAGE) << "The truth cache " << file_name_ << " does not "
+      << "exist yet. It is filled during this run." << std::endl;
+    return;
+  }
+  TFile file(file_name_.c_str(), "read");
+  TNamed* mc_key = dynamic_cast<TNamed*>(file.Get(kCacheKeyName));
+  TNamed* pfo_key = dynamic_cast<TNamed*>(file.Get(kCachePfoKeyName));
+  TTree* tree = dynamic_cast<TTree*>(file.Get(kCacheTreeName));
+  if (!mc_key || !pfo_key || !tree || mc_key_ != mc_key->GetTitle()) {
+    streamlog_out(WARNING) << "The truth cache " << file_name_ << " does not "
+      << "match the MC collection (" << mc_key_ << "). It is refilled."
+      << std::endl;
+    return;
+  }
+  pfo_key_ = pfo_key->GetTitle();
+
+  int run, event, has_truth, n_words;
+  Entry entry;
+  std::vector<ULong64_t> words(
+    std::max<std::size_t>(1, tree->GetMaximum("n_words")));
+  tree->SetBranchAddress("run", &run);
+  tree->SetBranchAddress("event", &event);
+  tree->SetBranchAddress("n_mc", &entry.n_mc);
+  tree->SetBranchAddress("n_pfos", &entry.n_pfos);
+  tree->SetBranchAddress("has_truth", &has_truth);
+  tree->SetBranchAddress("decays_invisible", &entry.truth.decays_invisible);
+  tree->SetBranchAddress("decay_mode", &entry.truth.decay_mode);
+  tree->SetBranchAddress("n_jets", &entry.truth.n_jets);
+  tree->SetBranchAddress("n_words", &n_words);
+  tree->SetBranchAddress("pfo_origin", words.data());
+  for (Long64_t i = 0; i < tree->GetEntries(); ++i) {
+    tree->GetEntry(i);
+    entry.has_truth = has_truth;
+    entry.pfo_origin.assign(words.begin(), words.begin() + n_words);
+    entries_[eventKey(run, event)] = entry;
+  }
+  streamlog_out(MESSAGE) << "Read " << entries_.size() << " events from the "
+    << "truth cache " << file_name_ << "." << std::endl;
+}
+
+void TruthCache::write() const {
+  std::vector<uint64_t> keys;
+  std::size_t max_words = 1;
+  for (const auto& key_entry : entries_) {
+    keys.push_back(key_entry.first);
+    max_words = std::max(max_words, key_entry.second.pfo_origin.size());
+  }
+  std::sort(keys.begin(), keys.end());
+
+  // Renamed when complete: Readers never see a partial file.
+  std::string temporary_name = file_name_ + ".tmp." + std::to_string(getpid());
+  TFile file(temporary_name.c_str(), "recreate");
+  if (file.IsZombie()) {
+    streamlog_out(ERROR) << "Could not write the truth cache " << file_name_
+      << "." << std::endl;
+    return;
+  }
+  TNamed mc_key(kCacheKeyName, mc_key_.c_str());
+  mc_key.Write();
+  TNamed pfo_key(kCachePfoKeyName, pfo_key_.c_str());
+  pfo_key.Write();
+  int run, event, n_mc, n_pfos, has_truth, n_words;
+  Truth truth;
+  std::vector<ULong64_t> words(max_words);
+  // The file owns the tree and deletes it in Close().
+  TTree* tree = new TTree(kCacheTreeName, "MC truth results per event.");
+  tree->Branch("run", &run, "run/I");
+  tree->Branch("event", &event, "event/I");
+  tree->Branch("n_mc", &n_mc, "n_mc/I");
+  tree->Branch("n_pfos", &n_pfos, "n_pfos/I");
+  tree->Branch("has_truth", &has_truth, "has_truth/I");
+  tree->Branch("decays_invisible", &truth.decays_invisible, "decays_invisible/I");
+  tree->Branch("decay_mode", &truth.decay_mode, "decay_mode/I");
+  tree->Branch("n_jets", &truth.n_jets, "n_jets/I");
+  tree->Branch("n_words", &n_words, "n_words/I");
+  tree->Branch("pfo_origin", words.data(), "pfo_origin[n_words]/l");
+  for (uint64_t k : keys) {
+    const Entry& entry = entries_.at(k);
+    run = int(k >> 32);
+    event = int(k & 0xffffffff);
+    n_mc = entry.n_mc;
+    n_pfos = entry.n_pfos;
+    has_truth = entry.has_truth;
+    truth = entry.truth;
+    n_words = entry.pfo_origin.size();
+    std::copy(entry.pfo_origin.begin(), entry.pfo_origin.end(), words.begin());
+    tree->Fill();
+  }
+  tree->Write();
+  file.Close();
+  if (std::rename(temporary_name.c_str(), file_name_.c_str()) != 0) {
+    streamlog_out(ERROR) << "Could not replace the truth cache " << file_name_
+      << " by " << temporary_name << "." << std::endl;
+    std::remove(temporary_name.c_str());
+    return;
+  }
+  streamlog_out(MESSAGE) << "Wrote " << keys.size() << " events to the truth "
+    << "cache " << file_name_ << "." << std::endl;
+}
@@ -0,0 +1,51 @@
+/**
+ *  Progress record of an output file in the resumable mode.
+ *
+ *  Each time the MakeHiggsVariablesProcessor commits its output, it writes
+ *  <output file>.progress next to it: The position of the first and of the
+ *  next event in the input stream (i.e. the event offset, counted over all
+ *  input files), the number of rows in the output and the last committed run
+ *  and event number. Rows and events differ if events are dropped (e.g. by
+ *  the prescaled mode). A restarted job with the same input files continues
+ *  after the committed events, which can be skipped with Marlin's SkipNEvents.
+ *
+ *  The record is written before the output is committed, and also keeps the
+ *  values of the previous commit. If the job is killed in between, the output
+ *  still has the rows of the previous commit, see resumeAt().
+ *
+ *  The record is a small text file with one "key value" pair per line. It is
+ *  replaced atomically (write and rename), so a job that is killed leaves
+ *  either the old or the new record.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _CHECKPOINT_H_
+#define _CHECKPOINT_H_
+// -- C++ STL headers.
+#include <string>
+
+struct Checkpoint {
+  long first_event = 0;  // Position of the first row in the input stream.
+  long next_event = 0;  // Position of the first event not yet committed.
+  long n_rows = 0;  // In the output up to next_event.
+  long previous_next_event = 0;  // Of the previous commit.
+  long previous_n_rows = 0;
+  int last_run = -1;
+  int last_event = -1;
+  std::string input_files{""};  // To recognize a different job.
+
+  static std::string fileName(const std::string& output_file_name) {
+    return output_file_name + ".progress";
+  }
+  // False if there is no (readable) record.
+  bool read(const std::string& file_name);
+  bool write(const std::string& file_name) const;
+  // The position to resume at, for the rows found in the output. -1 if they
+  // match neither commit.
+  long resumeAt(long rows) const {
+    if (rows == n_rows) return next_event;
+    if (rows == previous_n_rows) return previous_next_event;
+    return -1;
+  }
+};
+#endif
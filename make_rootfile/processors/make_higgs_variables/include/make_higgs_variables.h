@@ -14,20 +14,33 @@
 #ifndef _MAKE_HIGGS_VARIABLES_PROCESSOR_H_
 #define _MAKE_HIGGS_VARIABLES_PROCESSOR_H_
 // -- C++ STL headers.
-
-// -- ROOT headers.
-#include "TFile.h"
-#include "TTree.h"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
 
 // -- LCIO headers.
 #include "EVENT/MCParticle.h"
+#include "EVENT/ReconstructedParticle.h"
 
 // -- Marlin headers.
 #include "marlin/Processor.h"
 
 // -- Header for this processor and other project-specific headers.
+#include "collection_consumer.h"
+#include "checkpoint.h"
+#include "diagnostics.h"
+#include "higgs_descendant_index.h"
+#include "mc_graph.h"
+#include "output_backend.h"
+#include "output_merger.h"
+#include "perf_recorder.h"
+#include "pfo_kinematics.h"
+#include "truth_cache.h"
 
-class MakeHiggsVariablesProcessor : public marlin::Processor {
+class MakeHiggsVariablesProcessor : public marlin::Processor,
+                                    public CollectionConsumer {
  public:
   marlin::Processor* newProcessor() { return new MakeHiggsVariablesProcessor(); }
   MakeHiggsVariablesProcessor();
@@ -39,38 +52,158 @@ class MakeHiggsVariablesProcessor : public marlin::Processor {
   void init();
   void processEvent(EVENT::LCEvent* event);
   void end();
+  std::vector<std::string> inputCollections() const;
 
   void initRoot();
   void endRoot();
   void setHiggsKinematicInfo(EVENT::LCEvent* event);
+  // Full event and Higgs-only variables from a single loop over the PFOs.
+  void setFusedKinematicInfo(EVENT::LCEvent* event);
   void setIsolatedNumbers(EVENT::LCEvent* event);
+  // The flavour tags of the jets, if a FlavorTaggedJetCollection is given.
   void evaluateLCFIPlus(EVENT::LCEvent* event);
 
+  struct HiggsTruth {
+    int decays_invisible = false;
+    int decay_mode = -1;
+    int n_jets = -1;
+  };
+  // -1: Not tagged (no jet or no flavour tag).
+  struct FlavorTags {
+    int n_jets = 0;
+    float b_tag_jet1 = -1;
+    float b_tag_jet2 = -1;
+    float c_tag_jet1 = -1;
+    float c_tag_jet2 = -1;
+    float b_tag_max = -1;
+    float c_tag_max = -1;
+  };
+
+  HiggsTruth getHiggsTruth(EVENT::LCEvent* event);
+  // From the MC graph of the current event.
+  HiggsTruth getHiggsTruth();
+  // From the MC arrays of a skim file event (see skim_file.h), without LCIO.
+  HiggsTruth getHiggsTruth(const McGraph::Arrays& mc);
+  // The truth helpers work on the indices of the flattened MC graph.
+  bool decaysInvisible(int higgs);
+  int getNTrueJets(int higgs);
+  bool isLeptonicTauDecay(int tau);
+  const McGraph& mcGraph() const { return mc_graph_; }
+
  private:
   // -- Parameters registered in steering file.
   std::string higgs_only_collection_name_{""};
   std::string mc_collection_name{""};
+  std::string isolated_lepton_collection_name_{""};
   std::string flavor_tagged_collection_name{""};
+  std::string flavor_tag_algorithm_{""};
 
-  // -- The root file
-  TFile* root_file_{};
+  // -- The output files
+  std::string output_format_{""};
+  std::vector<std::string> histograms_{};
   std::string root_file_name_ = {""};
-  TTree* tree_ = {};
+  // In streaming mode, the tree is written while the events are processed.
+  bool stream_output_ = true;
+  int auto_flush_ = -30000000;
+  int auto_save_ = 100000;
+  int basket_size_ = 32000;
+  std::string compression_algorithm_{""};
+  int compression_level_ = 1;
+  bool write_pfo_arrays_ = false;
+  bool record_performance_ = true;
+  std::shared_ptr<PerfRecorder> perf_{};  // Null if not recorded.
+  std::string truth_cache_file_{""};
+  std::shared_ptr<TruthCache> truth_cache_{};  // Null if not used.
+  // Null before init(), e.g. for the standalone truth helpers.
+  std::shared_ptr<Diagnostics> diagnostics_{};
+  // True if an example of the condition should be logged.
+  bool report(Diagnostics::Kind kind, int pdg) {
+    return !diagnostics_ || diagnostics_->report(kind, pdg);
+  }
+
+  struct Output {
+    OutputOptions options{};
+    // Opened with the first event, once all clones have joined the merger.
+    std::unique_ptr<OutputBackend> backend{};
+    std::shared_ptr<OutputMerger> merger{};
+    int worker = 0;
+    // Positions in the input stream: Of the first row and of the first event
+    // that is not in the output yet (after resuming, not before the end of
+    // the committed events).
+    bool checkpointed = false;
+    long first_event = 0;
+    long next_event = 0;
+    // Of the last commit, see Checkpoint.
+    long committed_event = 0;
+    long committed_rows = 0;
+  };
+  Output output_{};
+  int merge_run_ = 0;
+  int merge_event_ = 0;
+
+  // -- Resumable mode: The output is committed every checkpoint_events_
+  // events, together with its progress record (see Checkpoint).
+  int checkpoint_events_ = 0;
+  std::string input_files_{""};
+  long position_ = 0;  // Of the next event in the input stream.
+  // The position of the event in the input stream. The first instance stores
+  // it in the event, since the later ones do not see the events it drops.
+  long streamPosition(EVENT::LCEvent* event);
+
+  // -- Fused mode: The overlay removal is done inline. Both the full event
+  // and the Higgs-only variables are written, from one pass over the PFOs.
+  bool fused_overlay_removal_ = false;
+  std::string relation_collection_name_{""};
+  std::string higgs_only_root_file_name_{""};
+  Output higgs_only_output_{};
+  HiggsDescendantIndex higgs_index_{};
+
+  // -- Prescaled mode: The Higgs truth is evaluated first. Of a decay mode
+  // with prescale n, only about every n-th event is processed, with the
+  // prescale weight n. The others skip the rest of this processor and all
+  // later processors. The seen and kept events are counted in diagnostics_.
+  std::vector<int> decay_mode_prescales_{};  // Pairs of h_decay and n.
+  std::map<int, int> prescales_{};
+  // The prescales of the first initialized instance. All instances have to
+  // drop the same events, or the rows of their outputs are not aligned.
+  static std::mutex first_prescales_mutex_;
+  static bool has_first_prescales_;
+  static std::string first_prescales_processor_;
+  static std::map<int, int> first_prescales_;
+  // The weight of the event, 0 if it is dropped. Deterministic in run and
+  // event number, so that all processors (and reruns) keep the same events.
+  int prescaleWeight(const HiggsTruth& higgs_truth, int run, int event);
 
   bool missing_mc_collection = false;
-  struct HiggsTruth {
-    int decays_invisible = false;
-    int decay_mode = -1;
-    int n_jets = -1;
+  // Rebuilt for each event. Together with the scratch stacks, no heap
+  // allocation is needed in the truth pass after the first few events.
+  McGraph mc_graph_{};
+  bool has_mc_graph_ = false;  // Whether mc_graph_ is from the current event.
+  int n_mc_ = -1;  // Of the current event, -1 if the collection is missing.
+  // With a truth cache, the MC graph is only built on a cache miss.
+  void buildMcGraph(EVENT::LCCollection* mc_collection);
+  std::vector<uint64_t> pfo_origin_{};
+  std::vector<int> truth_stack_{};
+
+  // The PID algorithm ID and the indices of the BTag and CTag parameters are
+  // resolved by name once per run, not for every event.
+  struct FlavorTagIndices {
+    int run = -1;  // For which they were resolved.
+    int algorithm = -1;  // -1: The jets have no flavour tag.
+    int b_tag = -1;
+    int c_tag = -1;
   };
-  HiggsTruth getHiggsTruth(EVENT::LCEvent* event);
-  bool decaysInvisible(std::vector<EVENT::MCParticle*> remnants);
-  int getNTrueJets(std::vector<EVENT::MCParticle*> remnants);
+  FlavorTagIndices flavor_tag_indices_{};
+  void resolveFlavorTagIndices(EVENT::LCCollection* jets, int run);
 
   struct TreeVars {
     TreeVars() {higgs_truth = HiggsTruth();};
     ~TreeVars() {};
 
+    // The event identity, e.g. to join the trees with and without overlay.
+    int run = -1;
+    int event = -1;
+
     int n_isolated_leptons = -1;
     int n_pfos = -1;
     int n_pfos_not_forward = -1;
@@ -84,29 +217,95 @@ class MakeHiggsVariablesProcessor : public marlin::Processor {
     float m_h = -1;
     float m_h_recoil = -1;
     float cos_theta_miss = -1;
+    float prescale_weight = 1;
 
     HiggsTruth higgs_truth{};
+    FlavorTags flavor_tags{};
 
-    void initBranches(TTree* tree) {
-      tree->Branch(("n_isolated_leptons"), &n_isolated_leptons, ("n_isolated_leptons/I"));
-      tree->Branch(("n_pfos"), &n_pfos, ("n_pfos/I"));
-      tree->Branch(("n_pfos_not_forward"), &n_pfos_not_forward, ("n_pfos_not_forward/I"));
-      tree->Branch(("n_charged_hadrons"), &n_charged_hadrons, ("n_charged_hadrons/I"));
-      tree->Branch(("n_neutral_hadrons"), &n_neutral_hadrons, ("n_neutral_hadrons/I"));
-      tree->Branch(("n_gamma"), &n_gamma, ("n_gamma/I"));
-      tree->Branch(("n_electrons"), &n_electrons, ("n_electrons/I"));
-      tree->Branch(("n_muons"), &n_muons, ("n_muons/I"));
-
-      tree->Branch(("e_h"), &e_h, ("e_h/F"));
-      tree->Branch(("m_h"), &m_h, ("m_h/F"));
-      tree->Branch(("m_h_recoil"), &m_h_recoil, ("m_h_recoil/F"));
-      tree->Branch(("cos_theta_miss"), &cos_theta_miss, ("cos_theta_miss/F"));
-
-      tree->Branch(("h_invisible"), &higgs_truth.decays_invisible, ("h_invisible/I"));
-      tree->Branch(("h_decay"), &higgs_truth.decay_mode, ("h_decay/I"));
+    // Per-PFO arrays (WritePfoArrays), in the order of the PFO collection.
+    // The vectors keep their capacity between events.
+    bool pfo_arrays = false;
+    std::vector<float> pfo_px{};
+    std::vector<float> pfo_py{};
+    std::vector<float> pfo_pz{};
+    std::vector<float> pfo_e{};
+    std::vector<int> pfo_type{};
+    std::vector<float> pfo_charge{};
+    std::vector<int> pfo_from_higgs{};  // -1: Unknown (e.g. no relations).
+
+    void addPfo(const EVENT::ReconstructedParticle* rp, int from_higgs) {
+      const double* p = rp->getMomentum();
+      pfo_px.push_back(p[0]);
+      pfo_py.push_back(p[1]);
+      pfo_pz.push_back(p[2]);
+      pfo_e.push_back(rp->getEnergy());
+      pfo_type.push_back(rp->getType());
+      pfo_charge.push_back(rp->getCharge());
+      pfo_from_higgs.push_back(from_higgs);
+    }
+
+    void reservePfoArrays(std::size_t n) {
+      for (std::vector<float>* v : {&pfo_px, &pfo_py, &pfo_pz, &pfo_e,
+                                    &pfo_charge}) {
+        v->reserve(n);
+      }
+      pfo_type.reserve(n);
+      pfo_from_higgs.reserve(n);
+    }
+
+    std::vector<Column> columns() {
+      const Column::Type I = Column::Type::kInt;
+      const Column::Type F = Column::Type::kFloat;
+      std::vector<Column> columns{
+        {"run", I, &run},
+        {"event", I, &event},
+
+        {"n_isolated_leptons", I, &n_isolated_leptons},
+        {"n_pfos", I, &n_pfos},
+        {"n_pfos_not_forward", I, &n_pfos_not_forward},
+        {"n_charged_hadrons", I, &n_charged_hadrons},
+        {"n_neutral_hadrons", I, &n_neutral_hadrons},
+        {"n_gamma", I, &n_gamma},
+        {"n_electrons", I, &n_electrons},
+        {"n_muons", I, &n_muons},
+
+        {"e_h", F, &e_h},
+        {"m_h", F, &m_h},
+        {"m_h_recoil", F, &m_h_recoil},
+        {"cos_theta_miss", F, &cos_theta_miss},
+
+        {"h_invisible", I, &higgs_truth.decays_invisible},
+        {"h_decay", I, &higgs_truth.decay_mode},
+        {"prescale_weight", F, &prescale_weight},
+
+        {"n_tagged_jets", I, &flavor_tags.n_jets},
+        {"b_tag_jet1", F, &flavor_tags.b_tag_jet1},
+        {"b_tag_jet2", F, &flavor_tags.b_tag_jet2},
+        {"c_tag_jet1", F, &flavor_tags.c_tag_jet1},
+        {"c_tag_jet2", F, &flavor_tags.c_tag_jet2},
+        {"b_tag_max", F, &flavor_tags.b_tag_max},
+        {"c_tag_max", F, &flavor_tags.c_tag_max},
+      };
+      if (pfo_arrays) {
+        const Column::Type IA = Column::Type::kIntArray;
+        const Column::Type FA = Column::Type::kFloatArray;
+        columns.insert(columns.end(), {
+          {"pfo_px", FA, &pfo_px},
+          {"pfo_py", FA, &pfo_py},
+          {"pfo_pz", FA, &pfo_pz},
+          {"pfo_e", FA, &pfo_e},
+          {"pfo_type", IA, &pfo_type},
+          {"pfo_charge", FA, &pfo_charge},
+          {"pfo_from_higgs", IA, &pfo_from_higgs},
+        });
+      }
+      return columns;
     }
 
     void resetValues() {
+      run = 0;
+      event = 0;
+
       n_isolated_leptons = 0;
       n_pfos = 0;
       n_pfos_not_forward = 0;
@@ -120,10 +319,32 @@ class MakeHiggsVariablesProcessor : public marlin::Processor {
       m_h = 0;
       m_h_recoil = 0;
       cos_theta_miss = 0;
+      prescale_weight = 1;
 
       higgs_truth = HiggsTruth();
+      flavor_tags = FlavorTags();
+
+      pfo_px.clear();
+      pfo_py.clear();
+      pfo_pz.clear();
+      pfo_e.clear();
+      pfo_type.clear();
+      pfo_charge.clear();
+      pfo_from_higgs.clear();
     }
   };
   TreeVars tv{};
+  TreeVars tv_higgs_only_{};
+
+  void initOutput(Output& output, const std::string& file_name);
+  void openOutput(Output& output, TreeVars& vars, long position);
+  void fillOutput(Output& output, long position);
+  void commitOutput(Output& output);
+  void endOutput(Output& output, TreeVars& vars);
+  // Sets the kinematic variables from the PFOs in the buffer.
+  void setKinematics(const PfoKinematics& pfos, TreeVars& vars);
+  // Reused between events.
+  PfoKinematics pfos_{};
+  PfoKinematics higgs_only_pfos_{};
 };
 #endif
\ No newline at end of file
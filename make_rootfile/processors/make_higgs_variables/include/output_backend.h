@@ -0,0 +1,103 @@
+/**
+ *  Output formats of the MakeHiggsVariablesProcessor.
+ *
+ *  The processor describes its per-event variables once as a list of columns
+ *  (name, type and the address of the value). A backend reads the current
+ *  values at these addresses on each fill(). Array columns (e.g. one entry per
+ *  PFO) point to a std::vector<int> or std::vector<float> whose size can
+ *  change from row to row.
+ *
+ *  Available formats:
+ *    - TTree: Classic ROOT tree with one leaf-list branch per column (one
+ *      std::vector branch per array column). With index columns, a TTreeIndex
+ *      is stored with the tree.
+ *    - RNTuple: ROOT's columnar successor of the TTree (ROOT >= 6.28).
+ *    - Parquet: Apache Parquet file (needs Arrow/Parquet at build time). No
+ *      array columns.
+ *    - Histograms: No per-event rows. Only histograms of the (scalar) columns,
+ *      split by the values of one int column, are written to a rootfile.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _OUTPUT_BACKEND_H_
+#define _OUTPUT_BACKEND_H_
+// -- C++ STL headers.
+#include <deque>
+#include <memory>
+#include <string>
+#include <vector>
+
+struct Column {
+  enum class Type { kInt, kFloat, kIntArray, kFloatArray };
+  std::string name;
+  Type type;
+  void* address;
+  bool isArray() const {
+    return type == Type::kIntArray || type == Type::kFloatArray;
+  }
+};
+
+struct OutputOptions {
+  std::string file_name{""};  // Without the file extension.
+  std::string tree_name{""};
+  std::string title{""};
+  bool stream = true;  // Only TTree can keep the full output in memory.
+  bool resume = false;  // Append to an existing file (TTree, streaming).
+  // Int columns of the event index, e.g. for GetEntryWithIndex(run, event).
+  std::string index_major{""};
+  std::string index_minor{""};
+  int auto_flush = -30000000;
+  int auto_save = 100000;
+  int basket_size = 32000;
+  std::string compression_algorithm{"ZLIB"};
+  int compression_level = 1;
+  // Histograms format: Groups of (column, n_bins, low, high), and the column
+  // whose values select the set of histograms that is filled.
+  std::vector<std::string> histograms{};
+  std::string histogram_split{""};
+  std::string histogram_weight{""};  // Float column. Empty: Unweighted.
+};
+
+class OutputBackend {
+ public:
+  virtual ~OutputBackend() {}
+  virtual void open(const std::vector<Column>& columns) = 0;
+  virtual void fill() = 0;
+  virtual void close() = 0;
+  // Backends that can sum the (still open) outputs of several clones in
+  // memory need no part files, see OutputMerger.
+  virtual bool mergesInMemory() const { return false; }
+  virtual void mergeFrom(const OutputBackend&) {}
+  // Resumable mode: Makes all rows filled so far durable, so that they
+  // survive a crash. False if not supported.
+  virtual bool commit() { return false; }
+  // The rows in the output, including those found when resuming.
+  virtual long nRows() const { return 0; }
+};
+
+// Throws std::runtime_error if the format is unknown or was not built in.
+std::unique_ptr<OutputBackend> makeOutputBackend(
+    const std::string& format, const OutputOptions& options);
+
+std::unique_ptr<OutputBackend> makeTreeOutput(const OutputOptions& options);
+std::unique_ptr<OutputBackend> makeRNTupleOutput(const OutputOptions& options);
+std::unique_ptr<OutputBackend> makeParquetOutput(const OutputOptions& options);
+std::unique_ptr<OutputBackend> makeHistogramOutput(const OutputOptions& options);
+
+// Same encoding as ROOT::CompressionSettings: 100 * algorithm + level.
+int compressionSettings(const std::string& algorithm, int level);
+
+class TTree;
+// SetBranchAddress of the columns' branches, also for array columns: Their
+// branches hold objects and take the address of a pointer to the object,
+// which are kept here. So the instance has to outlive the trees' reads.
+class BranchAddresses {
+ public:
+  void set(TTree* tree, const std::vector<Column>& columns);
+
+ private:
+  // Deques: The addresses stay valid when more are added.
+  std::deque<std::vector<int>*> int_arrays_{};
+  std::deque<std::vector<float>*> float_arrays_{};
+};
+#endif
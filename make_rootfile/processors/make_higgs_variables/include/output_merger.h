@@ -0,0 +1,74 @@
+/**
+ *  Combines the outputs of processor clones that share one output file.
+ *
+ *  In the multi-threaded mode, each worker runs its own clone of the
+ *  MakeHiggsVariablesProcessor. All clones with the same output file name
+ *  join the same merger in init(). If only one clone joined, it writes the
+ *  final output directly. Otherwise, each clone streams its events into its
+ *  own part file (a TTree with two extra sort-key columns). The last clone to
+ *  finish in end() merges the parts into the final output in the chosen
+ *  format, with the events ordered by (run number, event number). So the
+ *  result does not depend on how the events were distributed over the
+ *  workers. Backends that merge in memory (e.g. the histograms) are handed
+ *  over open instead, and summed without any part file.
+ *  A merger leaves the registry once its output is closed, so that a later
+ *  processor with the same file name (e.g. the next benchmark run) starts a
+ *  new one.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _OUTPUT_MERGER_H_
+#define _OUTPUT_MERGER_H_
+// -- C++ STL headers.
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// -- Header for this processor and other project-specific headers.
+#include "output_backend.h"
+
+class OutputMerger {
+ public:
+  OutputMerger(const std::string& format, const OutputOptions& options)
+    : format_(format), options_(options) {}
+  OutputMerger(const OutputMerger&) = delete;
+  OutputMerger& operator=(const OutputMerger&) = delete;
+
+  // All clones with the same options.file_name share one merger. The index
+  // of the joining worker is written to worker.
+  static std::shared_ptr<OutputMerger> join(
+      const std::string& format, const OutputOptions& options, int& worker);
+
+  // Only final once all workers have joined, i.e. after all init() calls.
+  int nWorkers() const;
+  // The part file of one worker.
+  OutputOptions partOptions(int worker) const;
+  // The sort-key columns that are appended to the columns of a part file.
+  static std::vector<Column> keyColumns(int* run, int* event);
+
+  // Called by each worker in end(). The columns are only used for their
+  // names and types. The last worker writes the merged output and gets true.
+  bool finish(int worker, bool wrote_part, const std::vector<Column>& columns);
+  // Instead of a part file (before finish). Only for mergesInMemory().
+  void addInMemoryPart(std::unique_ptr<OutputBackend> backend);
+  // Removes the merger from the registry. Called by finish(), and by a single
+  // worker that wrote the final output directly.
+  void release();
+
+ private:
+  void merge(const std::vector<Column>& columns);
+
+  static std::mutex registry_mutex_;
+  static std::map<std::string, std::shared_ptr<OutputMerger>> registry_;
+
+  mutable std::mutex mutex_{};
+  std::string format_;
+  OutputOptions options_;
+  int n_workers_ = 0;
+  int n_finished_ = 0;
+  std::vector<int> parts_{};
+  std::unique_ptr<OutputBackend> in_memory_{};  // The sum of the handed over.
+};
+#endif
@@ -0,0 +1,109 @@
+/**
+ *  PFO-wise kinematic variables of the MakeHiggsVariablesProcessor, computed
+ *  on structure-of-arrays buffers.
+ *
+ *  add() copies px, py, pz, E and the type class of one PFO into contiguous,
+ *  cache-line aligned arrays. compute() then derives the four-vector sum, the
+ *  number of PFOs outside the forward region and the number of PFOs per type
+ *  class without branches or trigonometric functions, in loops that the
+ *  compiler vectorizes:
+ *    - |cos(theta)| < 0.95 is tested as pz^2 < 0.95^2 * p^2. Together with the
+ *      sums, this is one pass over the momenta. The sums are split over kLanes
+ *      independent accumulators, so that the floating point additions need
+ *      not be reassociated (no -ffast-math needed).
+ *    - The PDG to type class mapping is a table lookup in add(). compute()
+ *      counts the classes with comparisons, one pass over the (int) class
+ *      array per class.
+ *
+ *  The buffers keep their capacity between events.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+#ifndef _PFO_KINEMATICS_H_
+#define _PFO_KINEMATICS_H_
+// -- C++ STL headers.
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+
+// -- LCIO headers.
+#include "EVENT/ReconstructedParticle.h"
+
+// Minimal allocator for std::vector buffers that start on a cache line.
+template <typename T>
+struct CacheLineAllocator {
+  typedef T value_type;
+  static const std::size_t kAlignment = 64;
+
+  CacheLineAllocator() = default;
+  template <typename U>
+  CacheLineAllocator(const CacheLineAllocator<U>&) {}
+
+  T* allocate(std::size_t n) {
+    void* p = nullptr;
+    if (posix_memalign(&p, kAlignment, n * sizeof(T)) != 0) {
+      throw std::bad_alloc();
+    }
+    return static_cast<T*>(p);
+  }
+  void deallocate(T* p, std::size_t) { free(p); }
+};
+template <typename T, typename U>
+bool operator==(const CacheLineAllocator<T>&, const CacheLineAllocator<U>&) {
+  return true;
+}
+template <typename T, typename U>
+bool operator!=(const CacheLineAllocator<T>&, const CacheLineAllocator<U>&) {
+  return false;
+}
+
+class PfoKinematics {
+ public:
+  enum PfoClass {
+    kElectron,
+    kMuon,
+    kGamma,
+    kChargedHadron,
+    kNeutralHadron,
+    kOtherPfo,  // Unexpected PDG.
+    kNPfoClasses
+  };
+  static const int kLanes = 4;
+
+  struct Sums {
+    double px = 0;
+    double py = 0;
+    double pz = 0;
+    double e = 0;
+    int n_pfos = 0;
+    int n_not_forward = 0;  // |cos(theta)| < 0.95.
+    int n_per_class[kNPfoClasses] = {};
+  };
+
+  void clear();
+  void add(const EVENT::ReconstructedParticle* rp) {
+    const double* p = rp->getMomentum();
+    add(p[0], p[1], p[2], rp->getEnergy(), rp->getType());
+  }
+  void add(double px, double py, double pz, double e, int pdg);
+  int size() const { return static_cast<int>(e_.size()); }
+  // The PDG of the i-th PFO, e.g. to report unexpected types.
+  int pdg(int i) const { return pdg_[i]; }
+  PfoClass pfoClass(int i) const { return static_cast<PfoClass>(class_[i]); }
+
+  Sums compute() const;
+
+  static PfoClass classOf(int pdg);
+
+ private:
+  template <typename T>
+  using Buffer = std::vector<T, CacheLineAllocator<T>>;
+  Buffer<double> px_{};
+  Buffer<double> py_{};
+  Buffer<double> pz_{};
+  Buffer<double> e_{};
+  Buffer<int32_t> class_{};
+  std::vector<int> pdg_{};
+};
+#endif
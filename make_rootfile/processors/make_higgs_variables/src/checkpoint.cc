@@ -0,0 +1,59 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <cstdio>
+#include <fstream>
+#include <sstream>
+
+// -- Header for this processor and other project-specific headers.
+#include "checkpoint.h"
+
+// ----------------------------------------------------------------------------
+bool Checkpoint::read(const std::string& file_name) {
+  std::ifstream file(file_name);
+  if (!file) return false;
+  bool has_next_event = false;
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream fields(line);
+    std::string key;
+    fields >> key;
+    if (key == "first_event") {
+      fields >> first_event;
+    } else if (key == "next_event") {
+      has_next_event = static_cast<bool>(fields >> next_event);
+    } else if (key == "n_rows") {
+      fields >> n_rows;
+    } else if (key == "previous_next_event") {
+      fields >> previous_next_event;
+    } else if (key == "previous_n_rows") {
+      fields >> previous_n_rows;
+    } else if (key == "last_run") {
+      fields >> last_run;
+    } else if (key == "last_event") {
+      fields >> last_event;
+    } else if (key == "input_files") {
+      std::getline(fields >> std::ws, input_files);
+    }
+  }
+  return has_next_event;
+}
+
+bool Checkpoint::write(const std::string& file_name) const {
+  std::string temporary_name = file_name + ".tmp";
+  {
+    std::ofstream file(temporary_name, std::ios::trunc);
+    file << "first_event " << first_event << "\n"
+      << "next_event " << next_event << "\n"
+      << "n_rows " << n_rows << "\n"
+      << "previous_next_event " << previous_next_event << "\n"
+      << "previous_n_rows " << previous_n_rows << "\n"
+      << "last_run " << last_run << "\n"
+      << "last_event " << last_event << "\n"
+      << "input_files " << input_files << "\n";
+    file.flush();
+    if (!file) return false;
+  }
+  return std::rename(temporary_name.c_str(), file_name.c_str()) == 0;
+}
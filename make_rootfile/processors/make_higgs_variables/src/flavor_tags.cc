@@ -0,0 +1,89 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <algorithm>
+
+// -- LCIO headers.
+#include "EVENT/LCCollection.h"
+#include "EVENT/ParticleID.h"
+#include "EVENT/ReconstructedParticle.h"
+#include "UTIL/PIDHandler.h"
+
+// -- Marlin headers.
+#include "marlin/Exceptions.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "make_higgs_variables.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+using RP = EVENT::ReconstructedParticle;
+
+// ----------------------------------------------------------------------------
+void MakeHiggsVariablesProcessor::evaluateLCFIPlus(EVENT::LCEvent* event) {
+  if (flavor_tagged_collection_name == "") return;
+  EVENT::LCCollection* jets = nullptr;
+  {
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kCollectionFetch);
+    try {
+      jets = event->getCollection(flavor_tagged_collection_name);
+    } catch (DataNotAvailableException &e) {
+      streamlog_out(ERROR) << "RP collection " << flavor_tagged_collection_name
+        << " is not available! Remember calling the LCFIPlus flavour tagging "
+        "before this processor." << std::endl;
+      throw marlin::StopProcessingException(this);
+    }
+  }
+  if (event->getRunNumber() != flavor_tag_indices_.run) {
+    resolveFlavorTagIndices(jets, event->getRunNumber());
+  }
+  FlavorTags& tags = tv.flavor_tags;
+  tags.n_jets = jets->getNumberOfElements();
+  const FlavorTagIndices& indices = flavor_tag_indices_;
+  if (indices.algorithm < 0) return;
+  const std::size_t n_parameters = std::max(indices.b_tag, indices.c_tag) + 1;
+  for (int i = 0; i < tags.n_jets; ++i) {
+    const RP* jet = static_cast<RP*>(jets->getElementAt(i));
+    // As UTIL::PIDHandler::getParticleID, without building a handler (and
+    // its name maps) for each event.
+    for (const EVENT::ParticleID* pid : jet->getParticleIDs()) {
+      if (pid->getAlgorithmType() != indices.algorithm) continue;
+      const EVENT::FloatVec& parameters = pid->getParameters();
+      if (parameters.size() < n_parameters) break;
+      float b_tag = parameters[indices.b_tag];
+      float c_tag = parameters[indices.c_tag];
+      if (i == 0) {
+        tags.b_tag_jet1 = b_tag;
+        tags.c_tag_jet1 = c_tag;
+      } else if (i == 1) {
+        tags.b_tag_jet2 = b_tag;
+        tags.c_tag_jet2 = c_tag;
+      }
+      tags.b_tag_max = std::max(tags.b_tag_max, b_tag);
+      tags.c_tag_max = std::max(tags.c_tag_max, c_tag);
+      break;
+    }
+  }
+}
+
+void MakeHiggsVariablesProcessor::resolveFlavorTagIndices(
+    EVENT::LCCollection* jets, int run) {
+  FlavorTagIndices indices;
+  indices.run = run;
+  try {
+    UTIL::PIDHandler pid_handler(jets);
+    int algorithm = pid_handler.getAlgorithmID(flavor_tag_algorithm_);
+    indices.b_tag = pid_handler.getParameterIndex(algorithm, "BTag");
+    indices.c_tag = pid_handler.getParameterIndex(algorithm, "CTag");
+    if (indices.b_tag >= 0 && indices.c_tag >= 0) indices.algorithm = algorithm;
+  } catch (UTIL::UnknownAlgorithm &e) {
+  }
+  if (indices.algorithm < 0) {
+    streamlog_out(WARNING) << "The jets in " << flavor_tagged_collection_name
+      << " of run " << run << " have no BTag and CTag of the algorithm "
+      << flavor_tag_algorithm_ << ". The flavour tags are left at -1."
+      << std::endl;
+  }
+  flavor_tag_indices_ = indices;
+}
@@ -14,115 +14,160 @@
 
 // -- Header for this processor and other project-specific headers.
 #include "make_higgs_variables.h"
-
-// -- Using-declarations and global constants.
-// Only in .cc files, never in .h header files!
-using MCP = EVENT::MCParticle;
+#include "pdg_taxonomy.h"
 
 // ----------------------------------------------------------------------------
-bool isHiggsToSameParticlePair(std::vector<MCP*> remnants) {
-  if (remnants.size() != 2) return false;
-  return fabs(remnants[0]->getPDG()) == fabs(remnants[1]->getPDG());
+bool isHiggsToSameParticlePair(const McGraph& graph, int higgs) {
+  if (graph.nDaughters(higgs) != 2) return false;
+  const int* r = graph.daughtersBegin(higgs);
+  return graph.absPdg(r[0]) == graph.absPdg(r[1]);
 }
 
-bool isHiggsToZGamma(std::vector<MCP*> r) {
-  if (r.size() != 2) return false;
-  if ((fabs(r[0]->getPDG()) == 22)  & (fabs(r[1]->getPDG()) == 23)) return true;
-  if ((fabs(r[0]->getPDG()) == 23)  & (fabs(r[1]->getPDG()) == 22)) return true;
+bool isHiggsToZGamma(const McGraph& graph, int higgs) {
+  if (graph.nDaughters(higgs) != 2) return false;
+  const int* r = graph.daughtersBegin(higgs);
+  if ((graph.absPdg(r[0]) == pdg::kPhoton) & (graph.absPdg(r[1]) == pdg::kZ)) return true;
+  if ((graph.absPdg(r[0]) == pdg::kZ) & (graph.absPdg(r[1]) == pdg::kPhoton)) return true;
   return false;
 }
 
 MakeHiggsVariablesProcessor::HiggsTruth MakeHiggsVariablesProcessor::getHiggsTruth(
     EVENT::LCEvent* event
   ) {
-  HiggsTruth higgs_info;
-
   EVENT::LCCollection* mc_collection = nullptr;
-  try {
-    mc_collection = event->getCollection(mc_collection_name);
-  } catch (DataNotAvailableException &e) {
-    missing_mc_collection = true;
+  has_mc_graph_ = false;
+  n_mc_ = -1;
+  {
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kCollectionFetch);
+    try {
+      mc_collection = event->getCollection(mc_collection_name);
+    } catch (DataNotAvailableException &e) {
+      missing_mc_collection = true;
+      return HiggsTruth();
+    }
+  }
+  n_mc_ = mc_collection->getNumberOfElements();
+  PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kTruthExtraction);
+  TruthCache::Truth cached;
+  if (truth_cache_ && truth_cache_->findTruth(
+      event->getRunNumber(), event->getEventNumber(), n_mc_, cached)) {
+    HiggsTruth higgs_info;
+    higgs_info.decays_invisible = cached.decays_invisible;
+    higgs_info.decay_mode = cached.decay_mode;
+    higgs_info.n_jets = cached.n_jets;
     return higgs_info;
   }
+  buildMcGraph(mc_collection);
+  HiggsTruth higgs_info = getHiggsTruth();
+  if (truth_cache_) {
+    cached.decays_invisible = higgs_info.decays_invisible;
+    cached.decay_mode = higgs_info.decay_mode;
+    cached.n_jets = higgs_info.n_jets;
+    truth_cache_->storeTruth(
+      event->getRunNumber(), event->getEventNumber(), n_mc_, cached);
+  }
+  return higgs_info;
+}
 
-  for (int i = 0; i < mc_collection->getNumberOfElements(); ++i) {
-    MCP* mcp = static_cast<MCP*>(mc_collection->getElementAt(i));
-    bool is_higgs = mcp->getPDG() == 25;
+void MakeHiggsVariablesProcessor::buildMcGraph(
+    EVENT::LCCollection* mc_collection) {
+  mc_graph_.build(mc_collection);
+  has_mc_graph_ = true;
+  if (perf_) perf_->count(PerfRecorder::kMcVisited, mc_graph_.size());
+}
+
+MakeHiggsVariablesProcessor::HiggsTruth MakeHiggsVariablesProcessor::getHiggsTruth(
+    const McGraph::Arrays& mc
+  ) {
+  mc_graph_.view(mc);
+  has_mc_graph_ = true;
+  n_mc_ = mc.n_collection;
+  return getHiggsTruth();
+}
+
+MakeHiggsVariablesProcessor::HiggsTruth MakeHiggsVariablesProcessor::getHiggsTruth() {
+  HiggsTruth higgs_info;
+  for (int i = 0; i < mc_graph_.nCollectionElements(); ++i) {
+    bool is_higgs = mc_graph_.pdg(i) == pdg::kHiggs;
     if (!is_higgs) continue;
+    if (mc_graph_.nDaughters(i) == 0) continue;
 
-    std::vector<MCP*> remnants = mcp->getDaughters();
-    bool is_intermediate_higgs = remnants[0]->getPDG() == 25;  // E.g. from hadronization.
+    const int* remnants = mc_graph_.daughtersBegin(i);
+    bool is_intermediate_higgs = mc_graph_.pdg(remnants[0]) == pdg::kHiggs;  // E.g. from hadronization.
     if (is_intermediate_higgs) continue;
 
-    if (isHiggsToSameParticlePair(remnants)) {
-      higgs_info.decay_mode = fabs(remnants[0]->getPDG());
-    } else if (isHiggsToZGamma(remnants)) {
+    if (isHiggsToSameParticlePair(mc_graph_, i)) {
+      higgs_info.decay_mode = mc_graph_.absPdg(remnants[0]);
+    } else if (isHiggsToZGamma(mc_graph_, i)) {
       higgs_info.decay_mode = 20;
-    } else {
+    } else if (report(Diagnostics::kUnforeseenHiggsDecay,
+                      mc_graph_.absPdg(remnants[0]))) {
       streamlog_out(ERROR) << "An unforeseen Higgs decay occurred. "
         << "The decay prodcuts are: ";
-      for (auto r : remnants) streamlog_out(ERROR) << r->getPDG() << ", ";
+      for (const int* r = remnants; r != mc_graph_.daughtersEnd(i); ++r) {
+        streamlog_out(ERROR) << mc_graph_.pdg(*r) << ", ";
+      }
       streamlog_out(ERROR) << "." << std::endl;
     }
 
-    higgs_info.decays_invisible = decaysInvisible(remnants);
-    higgs_info.n_jets = getNTrueJets(remnants);
+    higgs_info.decays_invisible = decaysInvisible(i);
+    higgs_info.n_jets = getNTrueJets(i);
   }
   return higgs_info;
 }
 
 
-bool MakeHiggsVariablesProcessor::decaysInvisible(std::vector<MCP*> remnants) {
-  std::vector<MCP*> stable_higgs_remnants;
-  while (!remnants.empty()) {
-    MCP* decay_product = remnants.back();
-    remnants.pop_back();
-    if (decay_product->getGeneratorStatus() == 1) {
-      stable_higgs_remnants.push_back(decay_product);
+bool MakeHiggsVariablesProcessor::decaysInvisible(int higgs) {
+  mc_graph_.newEpoch();
+  truth_stack_.clear();
+  for (const int* d = mc_graph_.daughtersBegin(higgs);
+       d != mc_graph_.daughtersEnd(higgs); ++d) {
+    if (mc_graph_.visit(*d)) truth_stack_.push_back(*d);
+  }
+  // The Higgs decays invisibly if none of the stable remnants is visible.
+  while (!truth_stack_.empty()) {
+    int decay_product = truth_stack_.back();
+    truth_stack_.pop_back();
+    if (mc_graph_.generatorStatus(decay_product) == 1) {
+      bool is_visible = !pdg::is(mc_graph_.pdg(decay_product), pdg::kInvisible);
+      if (is_visible) return false;
     } else {
-      for (auto daughter : decay_product->getDaughters()) {
-        remnants.push_back(daughter);
+      for (const int* d = mc_graph_.daughtersBegin(decay_product);
+           d != mc_graph_.daughtersEnd(decay_product); ++d) {
+        if (mc_graph_.visit(*d)) truth_stack_.push_back(*d);
       }
     }
   }
-  bool decays_invisible = true;
-  for (auto stable_mcp : stable_higgs_remnants) {
-    int abs_pdg = fabs(stable_mcp->getPDG());
-    bool is_visible = (abs_pdg != 12) && (abs_pdg != 14) && (abs_pdg != 16);
-    if (is_visible) {
-      decays_invisible = false;
-      break;
-    }
-  }
-  return decays_invisible;
+  return true;
 }
 
 
-bool isIn(std::vector<int> integers, int candidate) {
-  auto find_position = std::find(integers.begin(), integers.end(), candidate);
-  return find_position != integers.end();
-}
-
-bool isLeptonicTauDecay(MCP* tau) {
-  for (MCP* tau_daughter : tau->getDaughters()) {
-    int d_pdg = abs(tau_daughter->getPDG());
-    if ((d_pdg == 11) || (d_pdg == 13)) return true;
-    if ((d_pdg == 12) || (d_pdg == 14)) continue;
-    if ((d_pdg == 15) || (d_pdg == 24)) return isLeptonicTauDecay(tau_daughter);
-    if (d_pdg == 16) continue;  // Can appear in hadronization.
-    if (d_pdg == 94) {  // The hadronization PDG code.
-      int tau_pdg = tau->getPDG();
-      for (MCP* mc_after_mixing : tau_daughter->getDaughters()) {
-        if (mc_after_mixing->getPDG() == tau_pdg) {
-          return isLeptonicTauDecay(mc_after_mixing);
-        }
+bool MakeHiggsVariablesProcessor::isLeptonicTauDecay(int tau) {
+  for (const int* td = mc_graph_.daughtersBegin(tau);
+       td != mc_graph_.daughtersEnd(tau); ++td) {
+    int tau_daughter = *td;
+    int d_pdg = mc_graph_.absPdg(tau_daughter);
+    if ((d_pdg == pdg::kTau) || (d_pdg == pdg::kW)) {
+      return isLeptonicTauDecay(tau_daughter);
+    }
+    uint8_t d_flags = pdg::flags(d_pdg);
+    if (d_flags & pdg::kChargedLepton) return true;  // e or mu.
+    if (d_flags & pdg::kInvisible) continue;  // nu_tau can appear in hadronization.
+    if (d_flags & pdg::kHadronization) {
+      int tau_pdg = mc_graph_.pdg(tau);
+      for (const int* m = mc_graph_.daughtersBegin(tau_daughter);
+           m != mc_graph_.daughtersEnd(tau_daughter); ++m) {
+        if (mc_graph_.pdg(*m) == tau_pdg) return isLeptonicTauDecay(*m);
       }
       // Should never reach here.
-      streamlog_out(ERROR) << "Tau-daughters: ";
-      for (MCP* mc_after_mixing : tau_daughter->getDaughters()) {
-        streamlog_out(ERROR) << mc_after_mixing->getPDG() << ", ";
+      if (report(Diagnostics::kUnresolvedTauDecay, d_pdg)) {
+        streamlog_out(ERROR) << "Tau-daughters: ";
+        for (const int* m = mc_graph_.daughtersBegin(tau_daughter);
+             m != mc_graph_.daughtersEnd(tau_daughter); ++m) {
+          streamlog_out(ERROR) << mc_graph_.pdg(*m) << ", ";
+        }
+        streamlog_out(ERROR) << std::endl;
       }
-      streamlog_out(ERROR) << std::endl;
       return false;
     }
     return false;
@@ -130,38 +175,43 @@ bool isLeptonicTauDecay(MCP* tau) {
   return false;
 }
 
-int MakeHiggsVariablesProcessor::getNTrueJets(std::vector<MCP*> remnants) {
+int MakeHiggsVariablesProcessor::getNTrueJets(int higgs) {
   int n_true_jets = 0;
-  // quarks, gluon and tau "jets".
-  std::vector<int> jet_forming_pdgs = {1, 2, 3, 4, 5, 6, 21};
-  // No jet: Invisible neutrinos, or isolated photons and charged leptons.
-  std::vector<int> no_jet_pdgs = {11, 13, 12, 14, 16, 22};
-  while (!remnants.empty()) {
-    MCP* decay_product = remnants.back();
-    remnants.pop_back();
-
-    int pdg = fabs(decay_product->getPDG());
-    if (isIn(jet_forming_pdgs, pdg)) {
+
+  // Each particle is put on the stack at most once per call.
+  mc_graph_.newEpoch();
+  truth_stack_.clear();
+  for (const int* d = mc_graph_.daughtersBegin(higgs);
+       d != mc_graph_.daughtersEnd(higgs); ++d) {
+    if (mc_graph_.visit(*d)) truth_stack_.push_back(*d);
+  }
+  while (!truth_stack_.empty()) {
+    int decay_product = truth_stack_.back();
+    truth_stack_.pop_back();
+
+    int abs_pdg = mc_graph_.absPdg(decay_product);
+    uint8_t flags = pdg::flags(abs_pdg);
+    if (flags & pdg::kJetForming) {  // Quarks and gluons.
       n_true_jets++;
-    } else if (isIn(no_jet_pdgs, pdg)) {
-      continue;
-    } else if (pdg == 15) {
+    } else if (abs_pdg == pdg::kTau) {  // Hadronic tau "jets".
       if (isLeptonicTauDecay(decay_product)) continue;
       n_true_jets++;
+    } else if (flags & (pdg::kLepton | pdg::kGamma)) {
+      // No jet: Invisible neutrinos, or isolated photons and charged leptons.
+      continue;
     } else {
-      if ((decay_product->getGeneratorStatus() == 1 ) &&
-          (decay_product->getDaughters().size() == 0)) {
+      if ((mc_graph_.generatorStatus(decay_product) == 1 ) &&
+          (mc_graph_.nDaughters(decay_product) == 0) &&
+          report(Diagnostics::kStableWithoutJet, abs_pdg)) {
         streamlog_out(ERROR) << "This particle has neither daughters, nor is it"
           << " identified as a (stable) lepton/quark leading to a jet "
-          << "or a neutrino. PDG:" << pdg << std::endl;
+          << "or a neutrino. PDG:" << abs_pdg << std::endl;
       }
-      for (auto daughter : decay_product->getDaughters()) {
-        if (std::find(remnants.begin(), remnants.end(), daughter)
-            == remnants.end()) {
-          remnants.push_back(daughter);
-        }
+      for (const int* d = mc_graph_.daughtersBegin(decay_product);
+           d != mc_graph_.daughtersEnd(decay_product); ++d) {
+        if (mc_graph_.visit(*d)) truth_stack_.push_back(*d);
       }
     }
   }
   return n_true_jets;
-}
\ No newline at end of file
+}
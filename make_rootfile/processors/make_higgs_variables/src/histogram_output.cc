@@ -0,0 +1,176 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+
+// -- ROOT headers.
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1D.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "output_backend.h"
+
+// ----------------------------------------------------------------------------
+// Plain bin counters instead of TH1s: No ROOT object is touched in fill(), and
+// the clones in other threads do not share anything until they are merged.
+class HistogramOutput : public OutputBackend {
+ public:
+  explicit HistogramOutput(const OutputOptions& options) : options_(options) {}
+  HistogramOutput(const HistogramOutput&) = delete;
+  HistogramOutput& operator=(const HistogramOutput&) = delete;
+
+  void open(const std::vector<Column>& columns) {
+    if (options_.histograms.size() % 4 != 0) {
+      throw std::runtime_error("The histograms are given as groups of "
+        "column name, number of bins, lower and upper edge.");
+    }
+    for (std::size_t i = 0; i < options_.histograms.size(); i += 4) {
+      Axis axis;
+      axis.column = findColumn(columns, options_.histograms[i]);
+      axis.n_bins = std::atoi(options_.histograms[i + 1].c_str());
+      axis.low = std::atof(options_.histograms[i + 2].c_str());
+      axis.high = std::atof(options_.histograms[i + 3].c_str());
+      if (axis.n_bins <= 0 || !(axis.high > axis.low)) {
+        throw std::runtime_error("Invalid binning of the histogram of "
+          + axis.column.name + ".");
+      }
+      axes_.push_back(axis);
+    }
+    split_ = findColumn(columns, options_.histogram_split);
+    if (split_.type != Column::Type::kInt) {
+      throw std::runtime_error("The histograms can only be split by an int "
+        "column, not by " + split_.name + ".");
+    }
+    if (options_.histogram_weight != "") {
+      weight_ = findColumn(columns, options_.histogram_weight);
+      if (weight_.type != Column::Type::kFloat) {
+        throw std::runtime_error("The histogram weight must be a float "
+          "column, not " + weight_.name + ".");
+      }
+    }
+  }
+
+  void fill() {
+    Counts& counts = countsFor(*static_cast<int*>(split_.address));
+    double weight = weight_.address ? *static_cast<float*>(weight_.address) : 1;
+    ++counts.n_entries;
+    for (std::size_t a = 0; a < axes_.size(); ++a) {
+      int bin = axes_[a].bin();
+      counts.sum_w[a][bin] += weight;
+      counts.sum_w2[a][bin] += weight * weight;
+    }
+  }
+
+  bool mergesInMemory() const { return true; }
+
+  void mergeFrom(const OutputBackend& other) {
+    const HistogramOutput& part = dynamic_cast<const HistogramOutput&>(other);
+    for (const auto& split_counts : part.counts_) {
+      Counts& counts = countsFor(split_counts.first);
+      const Counts& part_counts = split_counts.second;
+      counts.n_entries += part_counts.n_entries;
+      for (std::size_t a = 0; a < axes_.size(); ++a) {
+        for (std::size_t b = 0; b < counts.sum_w[a].size(); ++b) {
+          counts.sum_w[a][b] += part_counts.sum_w[a][b];
+          counts.sum_w2[a][b] += part_counts.sum_w2[a][b];
+        }
+      }
+    }
+  }
+
+  // One directory per column, with one histogram per split value.
+  void close() {
+    TString fnn(options_.file_name.c_str()); fnn += ".root";
+    TFile file(fnn, "recreate");
+    if (file.IsZombie()) {
+      throw std::runtime_error("Could not open the output file "
+        + std::string(fnn.Data()) + ".");
+    }
+    file.SetCompressionSettings(compressionSettings(
+      options_.compression_algorithm, options_.compression_level));
+    for (std::size_t a = 0; a < axes_.size(); ++a) {
+      const Axis& axis = axes_[a];
+      TDirectory* directory = file.mkdir(axis.column.name.c_str());
+      for (const auto& split_counts : counts_) {
+        std::string name = split_.name + "_" + std::to_string(split_counts.first);
+        // The directory owns the histogram and deletes it in Close().
+        TH1D* histogram = new TH1D(name.c_str(), axis.column.name.c_str(),
+                                   axis.n_bins, axis.low, axis.high);
+        histogram->SetDirectory(directory);
+        // The errors of weighted bins are sqrt(sum of w^2).
+        histogram->Sumw2();
+        const Counts& counts = split_counts.second;
+        for (int b = 0; b < axis.n_bins + 2; ++b) {
+          histogram->SetBinContent(b, counts.sum_w[a][b]);
+          histogram->SetBinError(b, std::sqrt(counts.sum_w2[a][b]));
+        }
+        histogram->SetEntries(counts.n_entries);
+      }
+    }
+    file.Write();
+    file.Close();
+  }
+
+ private:
+  struct Axis {
+    Column column{};
+    int n_bins = 0;
+    double low = 0;
+    double high = 0;
+    // As in ROOT: 0 is the underflow, n_bins + 1 the overflow (also NaN).
+    int bin() const {
+      double value = column.type == Column::Type::kInt
+        ? *static_cast<int*>(column.address)
+        : *static_cast<float*>(column.address);
+      if (value < low) return 0;
+      if (!(value < high)) return n_bins + 1;
+      return 1 + static_cast<int>((value - low) / (high - low) * n_bins);
+    }
+  };
+
+  static Column findColumn(const std::vector<Column>& columns,
+                           const std::string& name) {
+    for (const Column& column : columns) {
+      if (column.name == name && column.isArray()) {
+        throw std::runtime_error("The array column " + name + " cannot be "
+          "histogrammed.");
+      }
+      if (column.name == name) return column;
+    }
+    throw std::runtime_error("There is no column " + name + " to histogram.");
+  }
+
+  // Per axis, the sums of the weights and of the squared weights per bin,
+  // including under- and overflow.
+  struct Counts {
+    long n_entries = 0;
+    std::vector<std::vector<double>> sum_w{};
+    std::vector<std::vector<double>> sum_w2{};
+  };
+
+  Counts& countsFor(int split_value) {
+    Counts& counts = counts_[split_value];
+    if (counts.sum_w.empty()) {
+      for (const Axis& axis : axes_) {
+        counts.sum_w.emplace_back(axis.n_bins + 2, 0.);
+        counts.sum_w2.emplace_back(axis.n_bins + 2, 0.);
+      }
+    }
+    return counts;
+  }
+
+  OutputOptions options_;
+  std::vector<Axis> axes_{};
+  Column split_{};
+  Column weight_{};  // Without address: Unweighted.
+  std::map<int, Counts> counts_{};  // Per split value.
+};
+
+std::unique_ptr<OutputBackend> makeHistogramOutput(const OutputOptions& options) {
+  return std::unique_ptr<OutputBackend>(new HistogramOutput(options));
+}
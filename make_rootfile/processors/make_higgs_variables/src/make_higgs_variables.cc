@@ -2,6 +2,7 @@
 *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
 */
 // -- C++ STL headers.
+#include <stdexcept>
 
 // -- ROOT headers.
 #include "TMath.h"
@@ -15,6 +16,7 @@
 
 // -- Marlin headers.
 #include "marlin/Exceptions.h"
+#include "marlin/Global.h"
 
 // -- Header for this processor and other project-specific headers.
 #include "make_higgs_variables.h"
@@ -23,6 +25,15 @@
 // Only in .cc files, never in .h header files!
 using RP = EVENT::ReconstructedParticle;
 using Tlv = ROOT::Math::XYZTVector;
+// Initial capacity of the per-PFO arrays, more than most events need.
+const std::size_t kPfoArrayCapacity = 512;
+// Event parameter: The position of the event in the input stream.
+const char* const kStreamPosition = "MakeHiggsVariablesStreamPosition";
+
+std::mutex MakeHiggsVariablesProcessor::first_prescales_mutex_;
+bool MakeHiggsVariablesProcessor::has_first_prescales_ = false;
+std::string MakeHiggsVariablesProcessor::first_prescales_processor_{""};
+std::map<int, int> MakeHiggsVariablesProcessor::first_prescales_{};
 
 // This line allows to register your processor in marlin when calling
 // "Marlin steering_file.xml".
@@ -48,97 +59,604 @@ MakeHiggsVariablesProcessor::MakeHiggsVariablesProcessor() :
     mc_collection_name,
     std::string("MCParticlesSkimmed"));
 
+  registerInputCollection(
+    LCIO::RECONSTRUCTEDPARTICLE,
+    "IsolatedLeptonCollection",
+    "Isolated leptons from the IsolatedLeptonTaggingProcessor.",
+    isolated_lepton_collection_name_,
+    std::string("IsolatedLeptons"));
+
+  registerInputCollection(
+    LCIO::RECONSTRUCTEDPARTICLE,
+    "FlavorTaggedJetCollection",
+    "Jets with the flavour tags of LCFIPlus (e.g. RefinedJets). The b- and "
+    "c-tags of the first two jets and the largest tags of all jets are "
+    "written. Empty: No flavour tags.",
+    flavor_tagged_collection_name,
+    std::string(""));
+
+  registerProcessorParameter(
+    "FlavorTagAlgorithm",
+    "Name of the PID algorithm of the flavour tags in the jet collection.",
+    flavor_tag_algorithm_,
+    std::string("lcfiplus"));
+
   registerProcessorParameter(
     "OutputRootFile",
     "Name of the output root file.",
     root_file_name_,
     std::string("higgs_variables"));
+
+  registerProcessorParameter(
+    "FusedOverlayRemoval",
+    "Also write the variables of the PFOs from the Higgs decay only, without "
+    "the need for an OverlayRemoverTruthProcessor and a second instance of "
+    "this processor. The HiggsCollection must be the full PFO collection.",
+    fused_overlay_removal_,
+    false);
+
+  registerInputCollection(
+    LCIO::LCRELATION,
+    "RelationCollection",
+    "Relation collection from the PFOs to the MCParticles (fused mode).",
+    relation_collection_name_,
+    std::string("RecoMCTruthLink"));
+
+  registerProcessorParameter(
+    "HiggsOnlyOutputRootFile",
+    "Name of the output root file with the Higgs-only variables (fused mode).",
+    higgs_only_root_file_name_,
+    std::string("no_overlay_higgs_variables"));
+
+  registerProcessorParameter(
+    "WritePfoArrays",
+    "Also write the px, py, pz, E, type, charge and Higgs origin (fused mode, "
+    "otherwise -1) of each PFO as variable-length arrays, e.g. to redo the "
+    "cuts offline with uproot.",
+    write_pfo_arrays_,
+    false);
+
+  registerProcessorParameter(
+    "RecordPerformance",
+    "Measure the time per stage of this and the other processors. The perf "
+    "and metadata trees are written next to the higgs tree (for Parquet, "
+    "into <OutputRootFile>.perf.root).",
+    record_performance_,
+    true);
+
+  registerProcessorParameter(
+    "TruthCacheFile",
+    "Rootfile that caches the Higgs truth (and in fused mode the Higgs origin "
+    "of the PFOs) per event. Reruns on the same events skip the MC traversal. "
+    "Empty: No cache.",
+    truth_cache_file_,
+    std::string(""));
+
+  registerProcessorParameter(
+    "OutputFormat",
+    "Format of the output file: TTree, RNTuple, Parquet or Histograms.",
+    output_format_,
+    std::string("TTree"));
+
+  registerProcessorParameter(
+    "Histograms",
+    "Histograms format: Groups of variable, number of bins, lower and upper "
+    "edge. Each variable is histogrammed per Higgs decay mode (h_decay).",
+    histograms_,
+    std::vector<std::string>{
+      "n_pfos", "200", "-0.5", "199.5",
+      "n_pfos_not_forward", "200", "-0.5", "199.5",
+      "n_charged_hadrons", "100", "-0.5", "99.5",
+      "n_neutral_hadrons", "100", "-0.5", "99.5",
+      "n_gamma", "100", "-0.5", "99.5",
+      "n_electrons", "20", "-0.5", "19.5",
+      "n_muons", "20", "-0.5", "19.5",
+      "n_isolated_leptons", "5", "-0.5", "4.5",
+      "e_h", "300", "0", "300",
+      "m_h", "300", "0", "300",
+      "m_h_recoil", "300", "-50", "250",
+      "cos_theta_miss", "100", "-1", "1",
+      "h_invisible", "2", "-0.5", "1.5"});
+
+  registerProcessorParameter(
+    "StreamOutput",
+    "Write the tree to the output file while processing the events. "
+    "Otherwise, the full tree is kept in memory and written in end(). "
+    "Only the TTree format supports the latter.",
+    stream_output_,
+    true);
+
+  registerProcessorParameter(
+    "AutoFlush",
+    "Flush the baskets after this many entries (>0) or bytes (<0).",
+    auto_flush_,
+    -30000000);
+
+  registerProcessorParameter(
+    "AutoSave",
+    "Save the tree header after this many entries (>0) or bytes (<0), so "
+    "that a crashed job leaves a readable file.",
+    auto_save_,
+    100000);
+
+  registerProcessorParameter(
+    "BasketSize",
+    "Basket size in bytes of each branch.",
+    basket_size_,
+    32000);
+
+  registerProcessorParameter(
+    "CompressionAlgorithm",
+    "Compression algorithm of the output file: ZLIB, LZMA, LZ4 or ZSTD.",
+    compression_algorithm_,
+    std::string("ZLIB"));
+
+  registerProcessorParameter(
+    "CompressionLevel",
+    "Compression level (0-9) of the output file.",
+    compression_level_,
+    1);
+
+  registerProcessorParameter(
+    "CheckpointEvents",
+    "Resumable mode (TTree, StreamOutput, one process per output file): "
+    "Commit the output every this many events, with a progress record "
+    "<OutputRootFile>.progress. A restarted job on the same input files "
+    "appends to the output and skips the committed events. 0: Off.",
+    checkpoint_events_,
+    0);
+
+  registerProcessorParameter(
+    "DecayModePrescales",
+    "Prescaled mode: Pairs of Higgs decay mode (h_decay) and prescale n. The "
+    "Higgs truth is evaluated first, and only about every n-th event of the "
+    "decay mode is processed (weight n in prescale_weight). Dropped events "
+    "skip the rest of this and all later processors. Unlisted decay modes are "
+    "kept. All MakeHiggsVariablesProcessors need the same value. Empty: Off.",
+    decay_mode_prescales_,
+    std::vector<int>());
 }
 
 // ----------------------------------------------------------------------------
 
 void MakeHiggsVariablesProcessor::initRoot() {
-  const char* tree_name = "higgs";
-  tree_ = new TTree(tree_name, "Input for the Higgs BR classes.");
-  tv.initBranches(tree_);
+  initOutput(output_, root_file_name_);
+  if (fused_overlay_removal_) {
+    initOutput(higgs_only_output_, higgs_only_root_file_name_);
+  }
+}
+
+void MakeHiggsVariablesProcessor::initOutput(
+    Output& output, const std::string& file_name) {
+  output.options.file_name = file_name;
+  output.options.tree_name = "higgs";
+  output.options.title = "Input for the Higgs BR classes.";
+  output.options.stream = stream_output_;
+  output.options.auto_flush = auto_flush_;
+  output.options.auto_save = auto_save_;
+  output.options.basket_size = basket_size_;
+  output.options.compression_algorithm = compression_algorithm_;
+  output.options.compression_level = compression_level_;
+  output.options.histograms = histograms_;
+  output.options.histogram_split = "h_decay";
+  if (!prescales_.empty()) output.options.histogram_weight = "prescale_weight";
+  output.options.index_major = "run";
+  output.options.index_minor = "event";
+  // Clones of this processor in other worker threads with the same output
+  // file share the merger.
+  output.merger = OutputMerger::join(
+    output_format_, output.options, output.worker);
+}
+
+void MakeHiggsVariablesProcessor::openOutput(
+    Output& output, TreeVars& vars, long position) {
+  try {
+    output.checkpointed = checkpoint_events_ > 0;
+    if (output.checkpointed && output.merger->nWorkers() > 1) {
+      streamlog_out(WARNING) << "The output " << output.options.file_name
+        << " is shared by several workers. It is not checkpointed."
+        << std::endl;
+      output.checkpointed = false;
+    }
+    Checkpoint checkpoint;
+    output.options.resume = output.checkpointed && checkpoint.read(
+      Checkpoint::fileName(output.options.file_name));
+    if (output.options.resume && checkpoint.input_files != input_files_) {
+      streamlog_out(WARNING) << "The progress record of "
+        << output.options.file_name << " belongs to other input files. "
+        << "The output is started anew." << std::endl;
+      output.options.resume = false;
+    }
+    output.backend = makeOutputBackend(output_format_, output.options);
+    if (output.merger->nWorkers() == 1 || output.backend->mergesInMemory()) {
+      output.backend->open(vars.columns());
+    } else {
+      std::vector<Column> columns = vars.columns();
+      for (const Column& key : OutputMerger::keyColumns(
+            &merge_run_, &merge_event_)) {
+        columns.push_back(key);
+      }
+      output.backend = makeTreeOutput(output.merger->partOptions(output.worker));
+      output.backend->open(columns);
+    }
+    output.first_event = position;
+    output.next_event = position;
+    if (output.options.resume) {
+      output.first_event = checkpoint.first_event;
+      output.next_event = checkpoint.resumeAt(output.backend->nRows());
+      if (output.next_event < 0) {
+        throw std::runtime_error("The " + std::to_string(
+          output.backend->nRows()) + " rows of " + output.options.file_name
+          + " do not match its progress record.");
+      }
+    }
+    output.committed_event = output.next_event;
+    output.committed_rows = output.backend->nRows();
+    if (output.next_event < position) {
+      streamlog_out(ERROR) << "The events " << output.next_event << " to "
+        << position - 1 << " are missing in " << output.options.file_name
+        << " (SkipNEvents too large?)." << std::endl;
+    }
+  } catch (std::runtime_error &e) {
+    streamlog_out(ERROR) << e.what() << std::endl;
+    throw marlin::StopProcessingException(this);
+  }
+}
+
+void MakeHiggsVariablesProcessor::fillOutput(Output& output, long position) {
+  if (position < output.next_event) return;  // Committed before resuming.
+  output.backend->fill();
+  output.next_event = position + 1;
+  // Not on multiples of the position: Dropped events leave gaps.
+  if (output.checkpointed
+      && output.next_event - output.committed_event >= checkpoint_events_) {
+    commitOutput(output);
+  }
+}
+
+void MakeHiggsVariablesProcessor::commitOutput(Output& output) {
+  // The record first: Until the output is committed, the previous commit
+  // in the record matches it.
+  Checkpoint checkpoint;
+  checkpoint.first_event = output.first_event;
+  checkpoint.next_event = output.next_event;
+  checkpoint.n_rows = output.backend->nRows();
+  checkpoint.previous_next_event = output.committed_event;
+  checkpoint.previous_n_rows = output.committed_rows;
+  checkpoint.last_run = merge_run_;
+  checkpoint.last_event = merge_event_;
+  checkpoint.input_files = input_files_;
+  if (!checkpoint.write(Checkpoint::fileName(output.options.file_name))) {
+    streamlog_out(WARNING) << "Could not write the progress record of "
+      << output.options.file_name << "." << std::endl;
+    return;
+  }
+  if (!output.backend->commit()) return;
+  output.committed_event = checkpoint.next_event;
+  output.committed_rows = checkpoint.n_rows;
 }
 
 void MakeHiggsVariablesProcessor::endRoot() {
-  TString fnn(root_file_name_.c_str()); fnn += ".root";
-  root_file_ = new TFile(fnn, "update");
-  root_file_->cd();
-  TTree* tree_in_write_file = tree_->CloneTree();
-  tree_in_write_file->Write();
-  root_file_->Write();
-  root_file_->Close();
+  endOutput(output_, tv);
+  if (fused_overlay_removal_) endOutput(higgs_only_output_, tv_higgs_only_);
+}
+
+void MakeHiggsVariablesProcessor::endOutput(Output& output, TreeVars& vars) {
+  bool is_final_output = true;
+  // Logged, not thrown: end() has to finish the other outputs (and Marlin the
+  // other processors) all the same.
+  try {
+    if (output.merger->nWorkers() == 1) {
+      // Write the (empty) file also without events.
+      if (!output.backend) openOutput(output, vars, position_);
+      if (output.checkpointed) commitOutput(output);
+      output.backend->close();
+      output.merger->release();
+    } else {
+      bool wrote_part = output.backend != nullptr;
+      if (wrote_part && output.backend->mergesInMemory()) {
+        output.merger->addInMemoryPart(std::move(output.backend));
+        wrote_part = false;
+      } else if (wrote_part) {
+        output.backend->close();
+      }
+      is_final_output = output.merger->finish(
+        output.worker, wrote_part, vars.columns());
+    }
+  } catch (std::runtime_error &e) {
+    streamlog_out(ERROR) << "The output " << output.options.file_name
+      << " is incomplete: " << e.what() << std::endl;
+    output.merger->release();
+    is_final_output = false;
+  } catch (marlin::StopProcessingException&) {
+    // openOutput() logged the reason.
+    output.merger->release();
+    is_final_output = false;
+  }
+  output.backend.reset();
+  output.merger.reset();
+  if (perf_ && is_final_output) {
+    std::string extension = output_format_ == "Parquet" ? ".perf.root" : ".root";
+    PerfRecorder::writeTrees(output.options.file_name + extension);
+  }
 }
 
 void MakeHiggsVariablesProcessor::init() {
+  if (decay_mode_prescales_.size() % 2 != 0) {
+    streamlog_out(ERROR) << "DecayModePrescales needs pairs of decay mode "
+      << "and prescale." << std::endl;
+    throw marlin::StopProcessingException(this);
+  }
+  for (std::size_t i = 0; i < decay_mode_prescales_.size(); i += 2) {
+    if (decay_mode_prescales_[i + 1] > 1) {
+      prescales_[decay_mode_prescales_[i]] = decay_mode_prescales_[i + 1];
+    }
+  }
+  {
+    std::lock_guard<std::mutex> lock(first_prescales_mutex_);
+    if (!has_first_prescales_) {
+      has_first_prescales_ = true;
+      first_prescales_processor_ = name();
+      first_prescales_ = prescales_;
+    } else if (prescales_ != first_prescales_) {
+      streamlog_out(ERROR) << "The DecayModePrescales of " << name()
+        << " differ from those of " << first_prescales_processor_ << ". All "
+        << "MakeHiggsVariablesProcessors need the same prescales." << std::endl;
+      throw marlin::StopProcessingException(this);
+    }
+  }
+  if (checkpoint_events_ > 0 && (output_format_ != "TTree" || !stream_output_)) {
+    streamlog_out(WARNING) << "Only the streamed TTree output can be resumed. "
+      << "CheckpointEvents is ignored." << std::endl;
+    checkpoint_events_ = 0;
+  }
+  if (checkpoint_events_ > 0 && marlin::Global::parameters) {
+    // Marlin skips these events before any processor sees them.
+    position_ = marlin::Global::parameters->getIntVal("SkipNEvents");
+    EVENT::StringVec input_files;
+    marlin::Global::parameters->getStringVals("LCIOInputFiles", input_files);
+    for (const std::string& file : input_files) input_files_ += file + " ";
+  }
+  for (TreeVars* vars : {&tv, &tv_higgs_only_}) {
+    vars->pfo_arrays = write_pfo_arrays_;
+    if (write_pfo_arrays_) vars->reservePfoArrays(kPfoArrayCapacity);
+  }
   initRoot();
+  if (record_performance_) perf_ = PerfRecorder::create(name());
+  diagnostics_ = Diagnostics::open(name());
+  if (truth_cache_file_ != "") {
+    // Without the fused overlay removal, only the Higgs truth is cached.
+    std::string pfo_key = fused_overlay_removal_ ? TruthCache::pfoKey(
+      higgs_only_collection_name_, relation_collection_name_) : "";
+    truth_cache_ = TruthCache::open(truth_cache_file_, mc_collection_name,
+                                    pfo_key);
+  }
 }
 
 void MakeHiggsVariablesProcessor::end() {
   endRoot();
+  // The last processor that releases the cache writes it.
+  truth_cache_.reset();
+  // The last clone logs the summary, also of the prescaled events.
+  diagnostics_.reset();
   if (missing_mc_collection) {
     streamlog_out(ERROR) << "At least one event did not provide "
       << "a MC Collection named " << mc_collection_name << ". " << std::endl;
   }
 }
 
+std::vector<std::string> MakeHiggsVariablesProcessor::inputCollections() const {
+  std::vector<std::string> collections{higgs_only_collection_name_,
+    mc_collection_name, isolated_lepton_collection_name_};
+  if (fused_overlay_removal_) collections.push_back(relation_collection_name_);
+  if (flavor_tagged_collection_name != "") {
+    collections.push_back(flavor_tagged_collection_name);
+  }
+  return collections;
+}
+
 // ----------------------------------------------------------------------------
 void MakeHiggsVariablesProcessor::processEvent(EVENT::LCEvent* event) {
   streamlog_out(DEBUG) << "Processing event no " << event->getEventNumber()
     << std::endl;
+  const long position = streamPosition(event);
+  if (!output_.backend) openOutput(output_, tv, position);
+  if (fused_overlay_removal_ && !higgs_only_output_.backend) {
+    openOutput(higgs_only_output_, tv_higgs_only_, position);
+  }
+  // Resumed job: The event was committed by an earlier run.
+  bool is_committed = position < output_.next_event && (!fused_overlay_removal_
+    || position < higgs_only_output_.next_event);
+  if (is_committed) return;
+  PerfRecorder::EventScope perf_event(perf_.get());
   tv.resetValues();
+  merge_run_ = event->getRunNumber();
+  merge_event_ = event->getEventNumber();
+  tv.run = merge_run_;
+  tv.event = merge_event_;
+  // First, so that a dropped event skips everything else (in the fused mode
+  // also the overlay removal). Also builds the MC graph.
+  tv.higgs_truth = getHiggsTruth(event);
+  if (!prescales_.empty()) {
+    int weight = prescaleWeight(tv.higgs_truth, merge_run_, merge_event_);
+    if (weight == 0) throw marlin::SkipEventException(this);
+    tv.prescale_weight = weight;
+  }
 
-  setHiggsKinematicInfo(event);
+  if (!fused_overlay_removal_) {
+    setHiggsKinematicInfo(event);
+    setIsolatedNumbers(event);
+    evaluateLCFIPlus(event);
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kTreeFill);
+    fillOutput(output_, position);
+    return;
+  }
+
+  tv_higgs_only_.resetValues();
   setIsolatedNumbers(event);
-  tv.higgs_truth = getHiggsTruth(event);
-  tree_->Fill();
+  evaluateLCFIPlus(event);
+  setFusedKinematicInfo(event);
+  // None of these depends on the PFOs.
+  tv_higgs_only_.run = tv.run;
+  tv_higgs_only_.event = tv.event;
+  tv_higgs_only_.n_isolated_leptons = tv.n_isolated_leptons;
+  tv_higgs_only_.higgs_truth = tv.higgs_truth;
+  tv_higgs_only_.prescale_weight = tv.prescale_weight;
+  tv_higgs_only_.flavor_tags = tv.flavor_tags;  // Jets of the full event.
+  PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kTreeFill);
+  fillOutput(output_, position);
+  fillOutput(higgs_only_output_, position);
+}
+
+long MakeHiggsVariablesProcessor::streamPosition(EVENT::LCEvent* event) {
+  long position = position_++;
+  EVENT::IntVec stored;
+  event->parameters().getIntVals(kStreamPosition, stored);
+  if (stored.empty()) {
+    event->parameters().setValue(kStreamPosition, static_cast<int>(position));
+    return position;
+  }
+  return stored[0];
+}
+
+int MakeHiggsVariablesProcessor::prescaleWeight(const HiggsTruth& higgs_truth,
+                                                int run, int event) {
+  auto it = prescales_.find(higgs_truth.decay_mode);
+  if (it == prescales_.end()) return 1;
+  // SplitMix64 finalizer: Consecutive event numbers are spread evenly.
+  uint64_t x = (uint64_t(uint32_t(run)) << 32) | uint32_t(event);
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  bool kept = x % it->second == 0;
+  diagnostics_->countPrescaled(kept);
+  return kept ? it->second : 0;
 }
 
 
 // ----------------------------------------------------------------------------
 void MakeHiggsVariablesProcessor::setHiggsKinematicInfo(EVENT::LCEvent* event) {
   EVENT::LCCollection* higgs_collection = nullptr;
-  try {
-    higgs_collection = event->getCollection(higgs_only_collection_name_);
-  } catch (DataNotAvailableException &e) {
-    streamlog_out(ERROR) << "RP collection " << higgs_only_collection_name_
-      << " is not available!" << std::endl;
-    throw marlin::StopProcessingException(this);
+  {
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kCollectionFetch);
+    try {
+      higgs_collection = event->getCollection(higgs_only_collection_name_);
+    } catch (DataNotAvailableException &e) {
+      streamlog_out(ERROR) << "RP collection " << higgs_only_collection_name_
+        << " is not available!" << std::endl;
+      throw marlin::StopProcessingException(this);
+    }
   }
-  Tlv higgs_four_vector(0, 0, 0, 0);
+  PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kKinematics);
+  if (perf_) perf_->count(PerfRecorder::kPfos, higgs_collection->getNumberOfElements());
+  pfos_.clear();
   for (int i = 0; i < higgs_collection->getNumberOfElements(); ++i) {
     RP* rp = static_cast<RP*>(higgs_collection->getElementAt(i));
-    Tlv rp_four_vector = Tlv(rp->getMomentum()[0], rp->getMomentum()[1],
-      rp->getMomentum()[2], rp->getEnergy());
-    higgs_four_vector += rp_four_vector;
-    if (fabs(cos(rp_four_vector.Theta())) < 0.95) tv.n_pfos_not_forward++;
-
-    int abs_pdg = abs(rp->getType());
-    if (abs_pdg == 11) {
-      tv.n_electrons += 1;
-    } else if (abs_pdg == 22) {
-      tv.n_gamma += 1;
-    } else if (abs_pdg == 13) {
-      tv.n_muons += 1;
-    } else if (abs_pdg == 211 || abs_pdg == 321 || abs_pdg == 2212) {
-      tv.n_charged_hadrons += 1;
-    } else if (abs_pdg == 130 || abs_pdg == 310 || abs_pdg == 2112 ||
-               abs_pdg == 3122) {
-      tv.n_neutral_hadrons += 1;
-    } else {
-      streamlog_out(WARNING) << "An unexpected PDG was found: " << abs_pdg
-        << "." << std::endl;
+    pfos_.add(rp);
+    if (tv.pfo_arrays) tv.addPfo(rp, -1);
+  }
+  setKinematics(pfos_, tv);
+}
+
+void MakeHiggsVariablesProcessor::setFusedKinematicInfo(EVENT::LCEvent* event) {
+  EVENT::LCCollection* pfo_collection = nullptr;
+  EVENT::LCCollection* relations = nullptr;
+  {
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kCollectionFetch);
+    try {
+      pfo_collection = event->getCollection(higgs_only_collection_name_);
+    } catch (DataNotAvailableException &e) {
+      streamlog_out(ERROR) << "RP collection " << higgs_only_collection_name_
+        << " is not available!" << std::endl;
+      throw marlin::StopProcessingException(this);
+    }
+    try {
+      relations = event->getCollection(relation_collection_name_);
+    } catch (DataNotAvailableException &e) {
+      streamlog_out(ERROR) << "The relation collection "
+        << relation_collection_name_ << " is not available! "
+        << "No PFO is identified as Higgs remnant." << std::endl;
+    }
+  }
+  const int n_pfos = pfo_collection->getNumberOfElements();
+  if (perf_) perf_->count(PerfRecorder::kPfos, n_pfos);
+  const int run = event->getRunNumber();
+  const int event_number = event->getEventNumber();
+  bool has_cached_origin = truth_cache_ && n_mc_ >= 0
+    && truth_cache_->findPfoOrigin(run, event_number, n_mc_, n_pfos, pfo_origin_);
+  if (!has_cached_origin && n_mc_ >= 0 && !has_mc_graph_) {
+    // The Higgs truth came from the cache, but the PFO origin did not.
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kNavigatorBuild);
+    buildMcGraph(event->getCollection(mc_collection_name));
+  }
+  // Without MC graph or relations, no PFO is identified as Higgs remnant (as
+  // in the OverlayRemoverTruthProcessor).
+  bool has_index = !has_cached_origin && has_mc_graph_ && relations;
+  if (has_index) {
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kNavigatorBuild);
+    higgs_index_.build(mc_graph_, relations);
+    if (perf_) {
+      perf_->count(PerfRecorder::kMcVisited, higgs_index_.nVisited());
+      perf_->countMax(PerfRecorder::kAncestryDepth, higgs_index_.maxDepth());
+    }
+    TruthCache::resetMask(pfo_origin_, n_pfos);
+  }
+
+  {
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kAncestrySearch);
+    pfos_.clear();
+    higgs_only_pfos_.clear();
+    for (int i = 0; i < n_pfos; ++i) {
+      RP* rp = static_cast<RP*>(pfo_collection->getElementAt(i));
+      pfos_.add(rp);
+      bool from_higgs = false;
+      if (has_cached_origin) {
+        from_higgs = TruthCache::testBit(pfo_origin_, i);
+      } else if (has_index && higgs_index_.isFromHiggs(rp)) {
+        from_higgs = true;
+        TruthCache::setBit(pfo_origin_, i);
+      }
+      if (from_higgs) higgs_only_pfos_.add(rp);
+      if (tv.pfo_arrays) {
+        // -1: Unknown, without relations (or MC graph) nothing is identified.
+        tv.addPfo(rp, has_cached_origin || has_index ? from_higgs : -1);
+        if (from_higgs) tv_higgs_only_.addPfo(rp, 1);
+      }
+    }
+  }
+  if (truth_cache_ && has_index) {
+    truth_cache_->storePfoOrigin(run, event_number, n_mc_, n_pfos, pfo_origin_);
+  }
+  PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kKinematics);
+  setKinematics(pfos_, tv);
+  setKinematics(higgs_only_pfos_, tv_higgs_only_);
+}
+
+void MakeHiggsVariablesProcessor::setKinematics(const PfoKinematics& pfos,
+                                                TreeVars& vars) {
+  PfoKinematics::Sums sums = pfos.compute();
+  vars.n_pfos = sums.n_pfos;
+  vars.n_pfos_not_forward = sums.n_not_forward;
+  vars.n_electrons = sums.n_per_class[PfoKinematics::kElectron];
+  vars.n_gamma = sums.n_per_class[PfoKinematics::kGamma];
+  vars.n_muons = sums.n_per_class[PfoKinematics::kMuon];
+  vars.n_charged_hadrons = sums.n_per_class[PfoKinematics::kChargedHadron];
+  vars.n_neutral_hadrons = sums.n_per_class[PfoKinematics::kNeutralHadron];
+  if (sums.n_per_class[PfoKinematics::kOtherPfo] > 0) {
+    for (int i = 0; i < pfos.size(); ++i) {
+      if (pfos.pfoClass(i) != PfoKinematics::kOtherPfo) continue;
+      if (report(Diagnostics::kUnexpectedPfoPdg, abs(pfos.pdg(i)))) {
+        streamlog_out(WARNING) << "An unexpected PDG was found: "
+          << abs(pfos.pdg(i)) << "." << std::endl;
+      }
     }
   }
-  tv.n_pfos = higgs_collection->getNumberOfElements();
 
-  tv.e_h = higgs_four_vector.E();
-  tv.m_h = higgs_four_vector.M();
-  tv.m_h_recoil = (Tlv(0, 0, 0, 250) - higgs_four_vector).mass();
-  tv.cos_theta_miss = cos(higgs_four_vector.Theta());
+  Tlv higgs_four_vector(sums.px, sums.py, sums.pz, sums.e);
+  vars.e_h = higgs_four_vector.E();
+  vars.m_h = higgs_four_vector.M();
+  vars.m_h_recoil = (Tlv(0, 0, 0, 250) - higgs_four_vector).mass();
+  vars.cos_theta_miss = cos(higgs_four_vector.Theta());
 }
 
 
@@ -146,10 +664,11 @@ void MakeHiggsVariablesProcessor::setHiggsKinematicInfo(EVENT::LCEvent* event) {
 void MakeHiggsVariablesProcessor::setIsolatedNumbers(EVENT::LCEvent* event) {
   //
   EVENT::LCCollection* lepton_collection = nullptr;
+  PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kCollectionFetch);
   try {
-    lepton_collection = event->getCollection("IsolatedLeptons");
+    lepton_collection = event->getCollection(isolated_lepton_collection_name_);
   } catch (DataNotAvailableException &e) {
-    streamlog_out(ERROR) << "RP collection " << "IsolatedLeptons"
+    streamlog_out(ERROR) << "RP collection " << isolated_lepton_collection_name_
       << " is not available! Remember calling the IsoLeptonTagging "
       "Processor before this one." << std::endl;
     throw marlin::StopProcessingException(this);
@@ -0,0 +1,50 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <stdexcept>
+
+// -- ROOT headers.
+#include "RVersion.h"
+
+// -- Marlin headers.
+#include "streamlog/streamlog.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "output_backend.h"
+
+// ----------------------------------------------------------------------------
+std::unique_ptr<OutputBackend> makeOutputBackend(
+    const std::string& format, const OutputOptions& options) {
+  if (format == "TTree") return makeTreeOutput(options);
+  if (format == "RNTuple") return makeRNTupleOutput(options);
+  if (format == "Parquet") return makeParquetOutput(options);
+  if (format == "Histograms") return makeHistogramOutput(options);
+  throw std::runtime_error("Unknown output format " + format
+    + ". Choose one of TTree, RNTuple, Parquet, Histograms.");
+}
+
+int compressionSettings(const std::string& algorithm, int level) {
+  int algorithm_id = 1;
+  if (algorithm == "ZLIB") {
+    algorithm_id = 1;
+  } else if (algorithm == "LZMA") {
+    algorithm_id = 2;
+  } else if (algorithm == "LZ4") {
+    algorithm_id = 4;
+  } else if (algorithm == "ZSTD") {
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 20, 0)
+    algorithm_id = 5;
+#else
+    streamlog_out(WARNING) << "ZSTD compression needs ROOT 6.20 or newer. "
+      << "LZ4 is used instead." << std::endl;
+    algorithm_id = 4;
+#endif
+  } else {
+    streamlog_out(WARNING) << "Unknown compression algorithm " << algorithm
+      << ". ZLIB is used instead." << std::endl;
+  }
+  if (level < 0) level = 0;
+  if (level > 9) level = 9;
+  return 100 * algorithm_id + level;
+}
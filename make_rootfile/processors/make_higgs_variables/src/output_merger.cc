@@ -0,0 +1,176 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <memory>
+#include <stdexcept>
+
+// -- ROOT headers.
+#include "TFile.h"
+#include "TTree.h"
+
+// -- Marlin headers.
+#include "streamlog/streamlog.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "output_merger.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+const char* const kMergeRun = "merge_run";
+const char* const kMergeEvent = "merge_event";
+
+std::mutex OutputMerger::registry_mutex_;
+std::map<std::string, std::shared_ptr<OutputMerger>> OutputMerger::registry_;
+
+// ----------------------------------------------------------------------------
+std::shared_ptr<OutputMerger> OutputMerger::join(
+    const std::string& format, const OutputOptions& options, int& worker) {
+  std::lock_guard<std::mutex> registry_lock(registry_mutex_);
+  std::shared_ptr<OutputMerger>& merger = registry_[options.file_name];
+  if (!merger) merger.reset(new OutputMerger(format, options));
+  std::lock_guard<std::mutex> lock(merger->mutex_);
+  worker = merger->n_workers_++;
+  return merger;
+}
+
+void OutputMerger::release() {
+  std::lock_guard<std::mutex> registry_lock(registry_mutex_);
+  // Not a newer merger for the same file.
+  auto it = registry_.find(options_.file_name);
+  if (it != registry_.end() && it->second.get() == this) registry_.erase(it);
+}
+
+int OutputMerger::nWorkers() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return n_workers_;
+}
+
+OutputOptions OutputMerger::partOptions(int worker) const {
+  OutputOptions part = options_;
+  part.file_name = options_.file_name + ".part" + std::to_string(worker);
+  part.stream = true;
+  part.index_major.clear();  // Only the merged output is indexed.
+  part.index_minor.clear();
+  return part;
+}
+
+std::vector<Column> OutputMerger::keyColumns(int* run, int* event) {
+  return {
+    {kMergeRun, Column::Type::kInt, run},
+    {kMergeEvent, Column::Type::kInt, event},
+  };
+}
+
+bool OutputMerger::finish(
+    int worker, bool wrote_part, const std::vector<Column>& columns) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (wrote_part) parts_.push_back(worker);
+    if (++n_finished_ < n_workers_) return false;
+  }
+  release();
+  if (in_memory_) {
+    in_memory_->close();
+    in_memory_.reset();
+    streamlog_out(MESSAGE) << "Merged the outputs of " << n_workers_
+      << " worker(s) into " << options_.file_name << "." << std::endl;
+  } else {
+    merge(columns);
+  }
+  return true;
+}
+
+void OutputMerger::addInMemoryPart(std::unique_ptr<OutputBackend> backend) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (!in_memory_) {
+    in_memory_ = std::move(backend);
+  } else {
+    in_memory_->mergeFrom(*backend);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void OutputMerger::merge(const std::vector<Column>& columns) {
+  // Ints and floats have the same size, so one buffer serves both.
+  static_assert(sizeof(int) == sizeof(float), "Column buffer layout.");
+  std::vector<uint32_t> buffer(columns.size());
+  std::deque<std::vector<int>> int_arrays;
+  std::deque<std::vector<float>> float_arrays;
+  std::vector<Column> buffer_columns;
+  for (std::size_t i = 0; i < columns.size(); ++i) {
+    void* address = &buffer[i];
+    if (columns[i].type == Column::Type::kIntArray) {
+      int_arrays.emplace_back();
+      address = &int_arrays.back();
+    } else if (columns[i].type == Column::Type::kFloatArray) {
+      float_arrays.emplace_back();
+      address = &float_arrays.back();
+    }
+    buffer_columns.push_back({columns[i].name, columns[i].type, address});
+  }
+  int run = 0;
+  int event = 0;
+
+  struct Row {
+    int run;
+    int event;
+    std::size_t part;
+    Long64_t entry;
+  };
+  std::vector<Row> rows;
+  std::sort(parts_.begin(), parts_.end());
+  // Closed and deleted also if the merge fails.
+  std::vector<std::unique_ptr<TFile>> files;
+  std::vector<TTree*> trees;
+  BranchAddresses branch_addresses;
+  for (int worker : parts_) {
+    std::string file_name = partOptions(worker).file_name + ".root";
+    files.emplace_back(TFile::Open(file_name.c_str(), "read"));
+    TFile* file = files.back().get();
+    TTree* tree = file ? dynamic_cast<TTree*>(file->Get(options_.tree_name.c_str()))
+                       : nullptr;
+    if (!tree) {
+      throw std::runtime_error("Could not read the part file " + file_name
+        + ". The part files are kept.");
+    }
+    trees.push_back(tree);
+
+    // Read only the sort keys in the first pass.
+    tree->SetBranchStatus("*", false);
+    tree->SetBranchStatus(kMergeRun, true);
+    tree->SetBranchStatus(kMergeEvent, true);
+    tree->SetBranchAddress(kMergeRun, &run);
+    tree->SetBranchAddress(kMergeEvent, &event);
+    for (Long64_t entry = 0; entry < tree->GetEntries(); ++entry) {
+      tree->GetEntry(entry);
+      rows.push_back({run, event, trees.size() - 1, entry});
+    }
+    tree->SetBranchStatus("*", true);
+    branch_addresses.set(tree, buffer_columns);
+  }
+  std::stable_sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) {
+    return a.run < b.run || (a.run == b.run && a.event < b.event);
+  });
+
+  std::unique_ptr<OutputBackend> output = makeOutputBackend(format_, options_);
+  output->open(buffer_columns);
+  for (const Row& row : rows) {
+    trees[row.part]->GetEntry(row.entry);
+    output->fill();
+  }
+  output->close();
+  streamlog_out(MESSAGE) << "Merged " << rows.size() << " events from "
+    << parts_.size() << " worker(s) into " << options_.file_name << "."
+    << std::endl;
+
+  for (std::size_t i = 0; i < files.size(); ++i) {
+    files[i]->Close();
+    files[i].reset();
+    std::remove((partOptions(parts_[i]).file_name + ".root").c_str());
+  }
+}
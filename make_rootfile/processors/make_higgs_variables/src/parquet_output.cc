@@ -0,0 +1,108 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <stdexcept>
+
+// -- Apache Arrow/Parquet headers.
+#ifdef WITH_PARQUET
+#include "arrow/io/file.h"
+#include "parquet/exception.h"
+#include "parquet/stream_writer.h"
+#endif
+
+// -- Marlin headers.
+#include "streamlog/streamlog.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "output_backend.h"
+
+// ----------------------------------------------------------------------------
+#ifdef WITH_PARQUET
+parquet::Compression::type parquetCompression(const std::string& algorithm) {
+  if (algorithm == "ZLIB") return parquet::Compression::GZIP;
+  if (algorithm == "LZ4") return parquet::Compression::LZ4;
+  if (algorithm == "ZSTD") return parquet::Compression::ZSTD;
+  streamlog_out(WARNING) << "Compression algorithm " << algorithm
+    << " is not available for Parquet. ZSTD is used instead." << std::endl;
+  return parquet::Compression::ZSTD;
+}
+
+class ParquetOutput : public OutputBackend {
+ public:
+  explicit ParquetOutput(const OutputOptions& options) : options_(options) {}
+  ParquetOutput(const ParquetOutput&) = delete;
+  ParquetOutput& operator=(const ParquetOutput&) = delete;
+
+  void open(const std::vector<Column>& columns) {
+    columns_ = columns;
+    parquet::schema::NodeVector fields;
+    for (const Column& column : columns) {
+      if (column.isArray()) {
+        // The StreamWriter has no repeated fields.
+        throw std::runtime_error("The Parquet output has no array columns ("
+          + column.name + "). Use the TTree or RNTuple output.");
+      }
+      // The StreamWriter checks the converted type of each value it writes.
+      bool is_int = column.type == Column::Type::kInt;
+      fields.push_back(parquet::schema::PrimitiveNode::Make(
+        column.name, parquet::Repetition::REQUIRED,
+        is_int ? parquet::Type::INT32 : parquet::Type::FLOAT,
+        is_int ? parquet::ConvertedType::INT_32 : parquet::ConvertedType::NONE));
+    }
+    auto schema = std::static_pointer_cast<parquet::schema::GroupNode>(
+      parquet::schema::GroupNode::Make(
+        "schema", parquet::Repetition::REQUIRED, fields));
+
+    PARQUET_ASSIGN_OR_THROW(outfile_, arrow::io::FileOutputStream::Open(
+      options_.file_name + ".parquet"));
+    // Compression is applied per data page.
+    parquet::WriterProperties::Builder builder;
+    builder.compression(parquetCompression(options_.compression_algorithm));
+    builder.compression_level(options_.compression_level);
+    builder.data_pagesize(options_.basket_size);
+    writer_.reset(new parquet::StreamWriter(parquet::ParquetFileWriter::Open(
+      outfile_, schema, builder.build())));
+    // Same convention as TTree::SetAutoFlush: bytes (<0) or entries (>0).
+    if (options_.auto_flush < 0) {
+      writer_->SetMaxRowGroupSize(-options_.auto_flush);
+    }
+  }
+
+  void fill() {
+    for (const Column& column : columns_) {
+      if (column.type == Column::Type::kInt) {
+        *writer_ << static_cast<int32_t>(*static_cast<const int*>(column.address));
+      } else {
+        *writer_ << *static_cast<const float*>(column.address);
+      }
+    }
+    *writer_ << parquet::EndRow;
+    if (options_.auto_flush > 0 && ++n_rows_in_group_ == options_.auto_flush) {
+      writer_->EndRowGroup();
+      n_rows_in_group_ = 0;
+    }
+  }
+
+  void close() {
+    writer_.reset();  // Writes the last row group and the file footer.
+    PARQUET_THROW_NOT_OK(outfile_->Close());
+  }
+
+ private:
+  OutputOptions options_;
+  std::vector<Column> columns_{};
+  std::shared_ptr<arrow::io::FileOutputStream> outfile_{};
+  std::unique_ptr<parquet::StreamWriter> writer_{};
+  int n_rows_in_group_ = 0;
+};
+
+std::unique_ptr<OutputBackend> makeParquetOutput(const OutputOptions& options) {
+  return std::unique_ptr<OutputBackend>(new ParquetOutput(options));
+}
+#else
+std::unique_ptr<OutputBackend> makeParquetOutput(const OutputOptions&) {
+  throw std::runtime_error("The Parquet output was not built. "
+    "Install Apache Arrow/Parquet and rebuild.");
+}
+#endif
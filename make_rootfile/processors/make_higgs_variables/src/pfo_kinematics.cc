@@ -0,0 +1,109 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- Header for this processor and other project-specific headers.
+#include "pdg_taxonomy.h"
+#include "pfo_kinematics.h"
+
+// -- Using-declarations and global constants.
+// Only in .cc files, never in .h header files!
+const double kMaxCos2 = 0.95 * 0.95;
+const int kClassTableSize = pdg::kTableSize;
+
+// |PDG| -> PfoClass, filled once from PfoKinematics::classOf (i.e. from the
+// PDG taxonomy, plus the electron/muon split).
+struct PfoClassTable {
+  PfoClassTable() {
+    for (int pdg = 0; pdg < kClassTableSize; ++pdg) {
+      classes[pdg] = PfoKinematics::classOf(pdg);
+    }
+  }
+  int32_t classes[kClassTableSize];
+};
+const PfoClassTable kPfoClassTable;
+
+// ----------------------------------------------------------------------------
+PfoKinematics::PfoClass PfoKinematics::classOf(int pdg) {
+  int abs_pdg = pdg < 0 ? -pdg : pdg;
+  uint8_t flags = pdg::flags(abs_pdg);
+  if (abs_pdg == pdg::kElectron) return kElectron;
+  if (abs_pdg == pdg::kMuon) return kMuon;
+  if (flags & pdg::kGamma) return kGamma;
+  if (flags & pdg::kChargedHadron) return kChargedHadron;
+  if (flags & pdg::kNeutralHadron) return kNeutralHadron;
+  return kOtherPfo;
+}
+
+void PfoKinematics::clear() {
+  px_.clear();
+  py_.clear();
+  pz_.clear();
+  e_.clear();
+  class_.clear();
+  pdg_.clear();
+}
+
+void PfoKinematics::add(double px, double py, double pz, double e, int pdg) {
+  px_.push_back(px);
+  py_.push_back(py);
+  pz_.push_back(pz);
+  e_.push_back(e);
+  unsigned abs_pdg = pdg < 0 ? -pdg : pdg;
+  class_.push_back(abs_pdg < kClassTableSize ? kPfoClassTable.classes[abs_pdg]
+                                             : kOtherPfo);
+  pdg_.push_back(pdg);
+}
+
+// ----------------------------------------------------------------------------
+PfoKinematics::Sums PfoKinematics::compute() const {
+  const std::size_t n = e_.size();
+  const std::size_t n_full_lanes = n - n % kLanes;
+  const double* __restrict__ px = px_.data();
+  const double* __restrict__ py = py_.data();
+  const double* __restrict__ pz = pz_.data();
+  const double* __restrict__ e = e_.data();
+  const int32_t* __restrict__ cls = class_.data();
+
+  // The four-vector sum and the forward test. The forward count is kept in
+  // doubles as well (exact up to 2^53), so that all lanes have the same width.
+  double sum_px[kLanes] = {};
+  double sum_py[kLanes] = {};
+  double sum_pz[kLanes] = {};
+  double sum_e[kLanes] = {};
+  double not_forward[kLanes] = {};
+  // One PFO into lane l. The comparison yields 0 or 1, so nothing branches.
+  auto accumulate = [&](std::size_t i, int l) {
+    sum_px[l] += px[i];
+    sum_py[l] += py[i];
+    sum_pz[l] += pz[i];
+    sum_e[l] += e[i];
+    double pz2 = pz[i] * pz[i];
+    double p2 = px[i] * px[i] + py[i] * py[i] + pz2;
+    not_forward[l] += pz2 < kMaxCos2 * p2 ? 1. : 0.;
+  };
+  for (std::size_t i = 0; i < n_full_lanes; i += kLanes) {
+    for (int l = 0; l < kLanes; ++l) accumulate(i + l, l);
+  }
+  for (std::size_t i = n_full_lanes; i < n; ++i) accumulate(i, i - n_full_lanes);
+
+  Sums sums;
+  sums.n_pfos = static_cast<int>(n);
+  double n_not_forward = 0;
+  for (int l = 0; l < kLanes; ++l) {
+    sums.px += sum_px[l];
+    sums.py += sum_py[l];
+    sums.pz += sum_pz[l];
+    sums.e += sum_e[l];
+    n_not_forward += not_forward[l];
+  }
+  sums.n_not_forward = static_cast<int>(n_not_forward);
+
+  // One pass over the type classes per class. An integer sum, so the
+  // compiler may reorder it freely.
+  for (int c = 0; c < kNPfoClasses; ++c) {
+    int32_t n_class = 0;
+    for (std::size_t i = 0; i < n; ++i) n_class += cls[i] == c;
+    sums.n_per_class[c] = n_class;
+  }
+  return sums;
+}
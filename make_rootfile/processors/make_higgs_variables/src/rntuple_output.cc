@@ -0,0 +1,91 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <stdexcept>
+#include <utility>
+
+// -- ROOT headers.
+#include "RVersion.h"
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 28, 0)
+#define HAS_RNTUPLE
+#include "ROOT/RNTupleModel.hxx"
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6, 30, 0)
+#include "ROOT/RNTupleWriteOptions.hxx"
+#include "ROOT/RNTupleWriter.hxx"
+#else
+#include "ROOT/RNTuple.hxx"
+#include "ROOT/RNTupleOptions.hxx"
+#endif
+#endif
+
+// -- Header for this processor and other project-specific headers.
+#include "output_backend.h"
+
+// ----------------------------------------------------------------------------
+#ifdef HAS_RNTUPLE
+namespace rntuple = ROOT::Experimental;
+
+class RNTupleOutput : public OutputBackend {
+ public:
+  explicit RNTupleOutput(const OutputOptions& options) : options_(options) {}
+  RNTupleOutput(const RNTupleOutput&) = delete;
+  RNTupleOutput& operator=(const RNTupleOutput&) = delete;
+
+  void open(const std::vector<Column>& columns) {
+    auto model = rntuple::RNTupleModel::Create();
+    for (const Column& column : columns) {
+      if (column.type == Column::Type::kInt) {
+        int_fields_.emplace_back(model->MakeField<int>(column.name),
+                                 static_cast<const int*>(column.address));
+      } else if (column.type == Column::Type::kFloat) {
+        float_fields_.emplace_back(model->MakeField<float>(column.name),
+                                   static_cast<const float*>(column.address));
+      } else if (column.type == Column::Type::kIntArray) {
+        int_array_fields_.emplace_back(
+          model->MakeField<std::vector<int>>(column.name),
+          static_cast<const std::vector<int>*>(column.address));
+      } else {
+        float_array_fields_.emplace_back(
+          model->MakeField<std::vector<float>>(column.name),
+          static_cast<const std::vector<float>*>(column.address));
+      }
+    }
+    rntuple::RNTupleWriteOptions write_options;
+    write_options.SetCompression(compressionSettings(
+      options_.compression_algorithm, options_.compression_level));
+    writer_ = rntuple::RNTupleWriter::Recreate(std::move(model),
+      options_.tree_name, options_.file_name + ".root", write_options);
+  }
+
+  void fill() {
+    for (auto& field : int_fields_) *field.first = *field.second;
+    for (auto& field : float_fields_) *field.first = *field.second;
+    // The assignment keeps the capacity of the field's vector.
+    for (auto& field : int_array_fields_) *field.first = *field.second;
+    for (auto& field : float_array_fields_) *field.first = *field.second;
+    writer_->Fill();
+  }
+
+  // The writer commits the last cluster when it is destroyed.
+  void close() { writer_.reset(); }
+
+ private:
+  OutputOptions options_;
+  std::unique_ptr<rntuple::RNTupleWriter> writer_{};
+  std::vector<std::pair<std::shared_ptr<int>, const int*>> int_fields_{};
+  std::vector<std::pair<std::shared_ptr<float>, const float*>> float_fields_{};
+  std::vector<std::pair<std::shared_ptr<std::vector<int>>,
+                        const std::vector<int>*>> int_array_fields_{};
+  std::vector<std::pair<std::shared_ptr<std::vector<float>>,
+                        const std::vector<float>*>> float_array_fields_{};
+};
+
+std::unique_ptr<OutputBackend> makeRNTupleOutput(const OutputOptions& options) {
+  return std::unique_ptr<OutputBackend>(new RNTupleOutput(options));
+}
+#else
+std::unique_ptr<OutputBackend> makeRNTupleOutput(const OutputOptions&) {
+  throw std::runtime_error("The RNTuple output needs ROOT 6.28 or newer.");
+}
+#endif
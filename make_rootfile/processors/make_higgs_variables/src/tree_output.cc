@@ -0,0 +1,144 @@
+/**
+*    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+*/
+// -- C++ STL headers.
+#include <stdexcept>
+
+// -- ROOT headers.
+#include "TFile.h"
+#include "TSystem.h"
+#include "TTree.h"
+
+// -- Marlin headers.
+#include "streamlog/streamlog.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "output_backend.h"
+
+// ----------------------------------------------------------------------------
+class TreeOutput : public OutputBackend {
+ public:
+  explicit TreeOutput(const OutputOptions& options) : options_(options) {}
+  TreeOutput(const TreeOutput&) = delete;
+  TreeOutput& operator=(const TreeOutput&) = delete;
+  ~TreeOutput() { delete root_file_; }
+
+  void open(const std::vector<Column>& columns) {
+    TString fnn(options_.file_name.c_str()); fnn += ".root";
+    bool resume = options_.stream && options_.resume
+      && !gSystem->AccessPathName(fnn);
+    if (options_.stream) {
+      // A file that was not closed is recovered up to its last AutoSave.
+      root_file_ = new TFile(fnn, resume ? "update" : "recreate");
+      if (root_file_->IsZombie()) {
+        throw std::runtime_error("Could not open the output file "
+          + std::string(fnn.Data()) + ".");
+      }
+      root_file_->SetCompressionSettings(compressionSettings(
+        options_.compression_algorithm, options_.compression_level));
+      root_file_->cd();
+    }
+    if (resume) {
+      tree_ = dynamic_cast<TTree*>(root_file_->Get(options_.tree_name.c_str()));
+      if (!tree_) {
+        streamlog_out(WARNING) << "No " << options_.tree_name << " tree to "
+          << "resume in " << fnn << ". It is started anew." << std::endl;
+      }
+    }
+    if (tree_) {
+      branch_addresses_.set(tree_, columns);
+      streamlog_out(MESSAGE) << "Resuming " << fnn << " after "
+        << tree_->GetEntries() << " events." << std::endl;
+    } else {
+      tree_ = new TTree(options_.tree_name.c_str(), options_.title.c_str());
+      // Do not end up in whichever file was opened last.
+      if (!options_.stream) tree_->SetDirectory(nullptr);
+      for (const Column& column : columns) {
+        if (column.type == Column::Type::kIntArray) {
+          tree_->Branch(column.name.c_str(),
+            static_cast<std::vector<int>*>(column.address), options_.basket_size);
+        } else if (column.type == Column::Type::kFloatArray) {
+          tree_->Branch(column.name.c_str(),
+            static_cast<std::vector<float>*>(column.address), options_.basket_size);
+        } else {
+          std::string leaf_list = column.name
+            + (column.type == Column::Type::kInt ? "/I" : "/F");
+          tree_->Branch(column.name.c_str(), column.address, leaf_list.c_str(),
+                        options_.basket_size);
+        }
+      }
+    }
+    if (options_.stream) {
+      tree_->SetAutoFlush(options_.auto_flush);
+      tree_->SetAutoSave(options_.auto_save);
+    }
+  }
+
+  void fill() { tree_->Fill(); }
+
+  bool commit() {
+    if (!options_.stream) return false;
+    // Also writes the keys list, the file is readable without recovery.
+    tree_->AutoSave("SaveSelf");
+    return true;
+  }
+
+  long nRows() const { return tree_ ? tree_->GetEntries() : 0; }
+
+  void close() {
+    if (options_.stream) {
+      buildIndex(tree_);
+      root_file_->cd();
+      // Overwrite the cycles left behind by AutoSave.
+      tree_->Write("", TObject::kOverwrite);
+      root_file_->Close();
+      delete root_file_;  // Also deletes the tree.
+      root_file_ = nullptr;
+      tree_ = nullptr;
+      return;
+    }
+    TString fnn(options_.file_name.c_str()); fnn += ".root";
+    root_file_ = new TFile(fnn, "update");
+    root_file_->cd();
+    TTree* tree_in_write_file = tree_->CloneTree();
+    buildIndex(tree_in_write_file);
+    tree_in_write_file->Write();
+    root_file_->Write();
+    root_file_->Close();
+    delete tree_;
+    tree_ = nullptr;
+  }
+
+ private:
+  // Sorted (major, minor) -> entry, written together with the tree. Lookups
+  // and friend trees with an index are O(log n).
+  void buildIndex(TTree* tree) {
+    if (options_.index_major.empty() || tree->GetEntries() == 0) return;
+    tree->BuildIndex(options_.index_major.c_str(),
+                     options_.index_minor.empty() ? "0"
+                                                  : options_.index_minor.c_str());
+  }
+
+  OutputOptions options_;
+  TFile* root_file_ = nullptr;
+  TTree* tree_ = nullptr;
+  BranchAddresses branch_addresses_{};  // Of a resumed tree.
+};
+
+void BranchAddresses::set(TTree* tree, const std::vector<Column>& columns) {
+  for (const Column& column : columns) {
+    if (column.type == Column::Type::kIntArray) {
+      int_arrays_.push_back(static_cast<std::vector<int>*>(column.address));
+      tree->SetBranchAddress(column.name.c_str(), &int_arrays_.back());
+    } else if (column.type == Column::Type::kFloatArray) {
+      float_arrays_.push_back(static_cast<std::vector<float>*>(column.address));
+      tree->SetBranchAddress(column.name.c_str(), &float_arrays_.back());
+    } else {
+      tree->SetBranchAddress(column.name.c_str(), column.address);
+    }
+  }
+}
+
+std::unique_ptr<OutputBackend> makeTreeOutput(const OutputOptions& options) {
+  return std::unique_ptr<OutputBackend>(new TreeOutput(options));
+}
@@ -6,26 +6,36 @@
  *
  *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
  */
-#ifndef _MAKE_HIGGS_VARIABLES_PROCESSOR_H_
-#define _MAKE_HIGGS_VARIABLES_PROCESSOR_H_
+#ifndef _OVERLAY_REMOVER_TRUTH_PROCESSOR_H_
+#define _OVERLAY_REMOVER_TRUTH_PROCESSOR_H_
 // -- C++ STL headers.
+#include <memory>
+#include <vector>
 
 // -- ROOT headers.
 #include "TFile.h"
 #include "TTree.h"
 
 // -- LCIO headers.
+#include "EVENT/LCCollection.h"
 #include "EVENT/LCEvent.h"
 #include "EVENT/MCParticle.h"
 #include "EVENT/ReconstructedParticle.h"
+#include "IMPL/LCCollectionVec.h"
 #include "UTIL/LCRelationNavigator.h"
 
 // -- Marlin headers.
 #include "marlin/Processor.h"
 
 // -- Header for this processor and other project-specific headers.
+#include "collection_consumer.h"
+#include "diagnostics.h"
+#include "higgs_descendant_index.h"
+#include "perf_recorder.h"
+#include "truth_cache.h"
 
-class OverlayRemoverTruthProcessor : public marlin::Processor {
+class OverlayRemoverTruthProcessor : public marlin::Processor,
+                                     public CollectionConsumer {
  public:
   marlin::Processor* newProcessor() { return new OverlayRemoverTruthProcessor(); }
   OverlayRemoverTruthProcessor();
@@ -33,15 +43,36 @@ class OverlayRemoverTruthProcessor : public marlin::Processor {
   // These two lines avoid frequent compiler warnings when using -Weffc++.
   OverlayRemoverTruthProcessor(const OverlayRemoverTruthProcessor&) = delete;
   OverlayRemoverTruthProcessor& operator=(const OverlayRemoverTruthProcessor&) = delete;
-  bool isFromHiggs(ReconstructedParticle* rp, EVENT::LCEvent* event);
+  // Reference implementation: Walks up the parent chain of a single PFO.
+  // Slow, processEvent uses the HiggsDescendantIndex instead.
   bool isFromHiggs(ReconstructedParticle* rp,
                     UTIL::LCRelationNavigator* relation_navigator);
+  void init();
   void processEvent(EVENT::LCEvent* event);
+  void end();
+  std::vector<std::string> inputCollections() const;
 
  private:
+  // True if the Higgs origin of the PFOs was taken from the truth cache.
+  bool addCachedPfos(EVENT::LCEvent* event, EVENT::LCCollection* full_collection,
+                     IMPL::LCCollectionVec* not_overlay_vec);
+  // True if an example of the PFO without MC link should be logged.
+  bool reportMissingMcLink(const ReconstructedParticle* rp);
+
   // -- Parameters registered in steering file.
   std::string full_pfo_collection_name_{""};
   std::string higgs_only_collection_name_{""};
   std::string mc_collection_name{""};
+  std::string relation_collection_name_{""};
+  bool record_performance_ = true;
+  std::string truth_cache_file_{""};
+
+  // Rebuilt for each event, but keeps its buffers.
+  HiggsDescendantIndex higgs_index_{};
+  std::shared_ptr<PerfRecorder> perf_{};  // Null if not recorded.
+  std::shared_ptr<TruthCache> truth_cache_{};  // Null if not used.
+  std::shared_ptr<Diagnostics> diagnostics_{};  // Null before init().
+  int n_mc_ = -1;  // Of the current event, for the truth cache.
+  std::vector<uint64_t> pfo_origin_{};
 };
 #endif
\ No newline at end of file
@@ -14,6 +14,7 @@
 
 // -- Header for this processor and other project-specific headers.
 #include "overlay_remover_truth.h"
+#include "pdg_taxonomy.h"
 
 // -- Using-declarations and global constants.
 // Only in .cc files, never in .h header files!
@@ -44,6 +45,55 @@ OverlayRemoverTruthProcessor::OverlayRemoverTruthProcessor() :
     "Name of the new PFO collection with (only) the Higgs decay remnants.",
     higgs_only_collection_name_,
     std::string("HiggsOnly"));
+
+  registerInputCollection(
+    LCIO::MCPARTICLE,
+    "MCParticleCollection",
+    "MCParticle collection in which the Higgs bosons are searched.",
+    mc_collection_name,
+    std::string("MCParticlesSkimmed"));
+
+  registerInputCollection(
+    LCIO::LCRELATION,
+    "RelationCollection",
+    "Relation collection from the PFOs to the MCParticles.",
+    relation_collection_name_,
+    std::string("RecoMCTruthLink"));
+
+  registerProcessorParameter(
+    "RecordPerformance",
+    "Measure the time per stage. The MakeHiggsVariablesProcessor writes it "
+    "into its output file (perf and metadata trees).",
+    record_performance_,
+    true);
+
+  registerProcessorParameter(
+    "TruthCacheFile",
+    "Rootfile that caches the Higgs origin of the PFOs per event. Reruns on "
+    "the same events skip the MC traversal. Empty: No cache.",
+    truth_cache_file_,
+    std::string(""));
+}
+
+void OverlayRemoverTruthProcessor::init() {
+  if (record_performance_) perf_ = PerfRecorder::create(name());
+  diagnostics_ = Diagnostics::open(name());
+  if (truth_cache_file_ != "") {
+    truth_cache_ = TruthCache::open(truth_cache_file_, mc_collection_name,
+      TruthCache::pfoKey(full_pfo_collection_name_, relation_collection_name_));
+  }
+}
+
+void OverlayRemoverTruthProcessor::end() {
+  // The last processor that releases the cache writes it.
+  truth_cache_.reset();
+  // The last clone logs the summary.
+  diagnostics_.reset();
+}
+
+std::vector<std::string> OverlayRemoverTruthProcessor::inputCollections() const {
+  return {full_pfo_collection_name_, mc_collection_name,
+          relation_collection_name_};
 }
 
 // ----------------------------------------------------------------------------
@@ -51,35 +101,111 @@ void OverlayRemoverTruthProcessor::processEvent(EVENT::LCEvent* event) {
   streamlog_out(DEBUG) << "Processing event no " << event->getEventNumber()
     << std::endl;
 
+  PerfRecorder::EventScope perf_event(perf_.get());
   EVENT::LCCollection* full_collection = nullptr;
-  try {
-    full_collection = event->getCollection(full_pfo_collection_name_);
-  } catch (DataNotAvailableException &e) {
-    streamlog_out(ERROR) << "RP collection " << full_pfo_collection_name_
-      << " is not available!" << std::endl;
-    throw marlin::StopProcessingException(this);
-  }
-
-  std::vector<RP*> not_overlay_particles;
-  for (int e = 0; e < full_collection->getNumberOfElements(); ++e) {
-    RP* pfo = static_cast<RP*>(full_collection->getElementAt(e));
-    if (isFromHiggs(pfo, event)) not_overlay_particles.push_back(pfo);
+  {
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kCollectionFetch);
+    try {
+      full_collection = event->getCollection(full_pfo_collection_name_);
+    } catch (DataNotAvailableException &e) {
+      streamlog_out(ERROR) << "RP collection " << full_pfo_collection_name_
+        << " is not available!" << std::endl;
+      throw marlin::StopProcessingException(this);
+    }
   }
 
   LCCollectionVec* not_overlay_vec = new LCCollectionVec(
       LCIO::RECONSTRUCTEDPARTICLE);
   not_overlay_vec->setSubset(true);
-  for (auto pfo : not_overlay_particles) not_overlay_vec->addElement(pfo);
   event->addCollection(not_overlay_vec, higgs_only_collection_name_.c_str());
+  if (addCachedPfos(event, full_collection, not_overlay_vec)) return;
+
+  HiggsDescendantIndex::BuildStatus status;
+  {
+    PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kNavigatorBuild);
+    status = higgs_index_.build(
+        event, mc_collection_name, relation_collection_name_);
+  }
+  if (status == HiggsDescendantIndex::BuildStatus::kMissingMcCollection) {
+    streamlog_out(ERROR) << "The MC collection " << mc_collection_name
+      << " is not available! No PFO is identified as Higgs remnant."
+      << std::endl;
+    return;
+  }
+  if (status == HiggsDescendantIndex::BuildStatus::kMissingRelationCollection) {
+    streamlog_out(ERROR) << "The relation collection "
+      << relation_collection_name_ << " is not available! "
+      << "No PFO is identified as Higgs remnant." << std::endl;
+    return;
+  }
+
+  if (perf_) {
+    perf_->count(PerfRecorder::kPfos, full_collection->getNumberOfElements());
+    perf_->count(PerfRecorder::kMcVisited, higgs_index_.nVisited());
+    perf_->countMax(PerfRecorder::kAncestryDepth, higgs_index_.maxDepth());
+  }
+  PerfRecorder::Scope perf_scope(perf_.get(), PerfRecorder::kAncestrySearch);
+  TruthCache::resetMask(pfo_origin_, full_collection->getNumberOfElements());
+  for (int e = 0; e < full_collection->getNumberOfElements(); ++e) {
+    RP* pfo = static_cast<RP*>(full_collection->getElementAt(e));
+    if (!higgs_index_.hasMcLink(pfo)) {
+      if (reportMissingMcLink(pfo)) {
+        streamlog_out(WARNING) << "There is a ReconstructedParticle that is not "
+          << "related to any MonteCarlo particle. Maybe the relation collection "
+          << "is faulty?" << std::endl;
+      }
+      continue;
+    }
+    if (higgs_index_.isFromHiggs(pfo)) {
+      not_overlay_vec->addElement(pfo);
+      TruthCache::setBit(pfo_origin_, e);
+    }
+  }
+  if (truth_cache_ && n_mc_ >= 0) {
+    truth_cache_->storePfoOrigin(event->getRunNumber(), event->getEventNumber(),
+      n_mc_, full_collection->getNumberOfElements(), pfo_origin_);
+  }
+}
+
+bool OverlayRemoverTruthProcessor::addCachedPfos(
+    EVENT::LCEvent* event, EVENT::LCCollection* full_collection,
+    LCCollectionVec* not_overlay_vec) {
+  n_mc_ = -1;
+  if (!truth_cache_) return false;
+  try {
+    n_mc_ = event->getCollection(mc_collection_name)->getNumberOfElements();
+  } catch (DataNotAvailableException &e) {
+    return false;  // Reported when building the index.
+  }
+  int n_pfos = full_collection->getNumberOfElements();
+  if (!truth_cache_->findPfoOrigin(event->getRunNumber(),
+      event->getEventNumber(), n_mc_, n_pfos, pfo_origin_)) {
+    return false;
+  }
+  if (perf_) perf_->count(PerfRecorder::kPfos, n_pfos);
+  for (int e = 0; e < n_pfos; ++e) {
+    if (TruthCache::testBit(pfo_origin_, e)) {
+      not_overlay_vec->addElement(full_collection->getElementAt(e));
+    }
+  }
+  return true;
+}
+
+bool OverlayRemoverTruthProcessor::reportMissingMcLink(
+    const ReconstructedParticle* rp) {
+  // Without init() (e.g. a standalone isFromHiggs call), every case is logged.
+  return !diagnostics_
+    || diagnostics_->report(Diagnostics::kPfoWithoutMcLink, rp->getType());
 }
 
 bool OverlayRemoverTruthProcessor::isFromHiggs(
     RP* rp, UTIL::LCRelationNavigator* relation_navigator) {
-  int higgs_pdg = 25;
   if (relation_navigator->getRelatedToObjects(rp).size() == 0) {
-    std::cout << "There is a ReconstructedParticle that is not related to any"
-      << " MonteCarlo particle. Maybe the relation collection is faulty?"
-      << std::endl;
+    if (reportMissingMcLink(rp)) {
+      streamlog_out(WARNING) << "There is a ReconstructedParticle that is not "
+        << "related to any MonteCarlo particle. Maybe the relation collection "
+        << "is faulty?" << std::endl;
+    }
     return false;
   }
   MCP* mcp = static_cast<MCP*>(relation_navigator->getRelatedToObjects(rp)[0]);
@@ -87,26 +213,10 @@ bool OverlayRemoverTruthProcessor::isFromHiggs(
   while (mc_parents.size() > 0) {
     mcp = mc_parents.back();
     mc_parents.pop_back();
-    if (mcp->getPDG() == higgs_pdg) return true;
+    if (mcp->getPDG() == pdg::kHiggs) return true;
     for (auto parent : mcp->getParents()) {
       mc_parents.push_back(parent);
     }
   }
   return false;
 }
-
-bool OverlayRemoverTruthProcessor::isFromHiggs(RP* rp, EVENT::LCEvent* event) {
-  std::string link_col_name = "RecoMCTruthLink";
-  EVENT::LCCollection* relation_collection = nullptr;
-  UTIL::LCRelationNavigator* relation_navigator = nullptr;
-  try {
-    relation_collection = event->getCollection(link_col_name);
-    relation_navigator = new UTIL::LCRelationNavigator(relation_collection);
-  } catch (DataNotAvailableException &e) {
-    streamlog_out(ERROR) << "The relation collection " << link_col_name
-      << " is not available!"
-      << "false is returned for this search." << std::endl;
-    return false;
-  }
-  return isFromHiggs(rp, relation_navigator);
-}
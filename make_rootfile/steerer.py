@@ -53,20 +53,24 @@ if __name__ == "__main__":
         "OutputIsoLeptonsCollection": dict(value="IsolatedLeptons"),
         "OutputPFOsWithoutIsoLepCollection": dict(value="PFOsNoIsoleptons"),
     })
+    fused_overlay_removal = False  # One processor writes both files.
     steerer.add("MakeHiggsVariablesProcessor", {
         "HiggsCollection": dict(value="PandoraPFOs"),
         "MCParticleCollection": dict(value="MCParticlesSkimmed"),
         "OutputRootFile": dict(value="higgs_variables"),
+        "FusedOverlayRemoval": dict(value=str(fused_overlay_removal).lower()),
+        "HiggsOnlyOutputRootFile": dict(value="no_overlay_higgs_variables"),
     })
-    steerer.add("OverlayRemoverTruthProcessor", {
-        "PfoCollection": dict(value="PandoraPFOs"),
-        "HiggsOnlyCollection": dict(value="HiggsOnly"),
-    })
-    steerer.add("MakeHiggsVariablesProcessor", {
-        "HiggsCollection": dict(value="HiggsOnly"),
-        "MCParticleCollection": dict(value="MCParticlesSkimmed"),
-        "OutputRootFile": dict(value="no_overlay_higgs_variables"),
-    })
+    if not fused_overlay_removal:
+        steerer.add("OverlayRemoverTruthProcessor", {
+            "PfoCollection": dict(value="PandoraPFOs"),
+            "HiggsOnlyCollection": dict(value="HiggsOnly"),
+        })
+        steerer.add("MakeHiggsVariablesProcessor", {
+            "HiggsCollection": dict(value="HiggsOnly"),
+            "MCParticleCollection": dict(value="MCParticlesSkimmed"),
+            "OutputRootFile": dict(value="no_overlay_higgs_variables"),
+        })
 
     newSampleRun(steerer)
     oldSampleRun(steerer)
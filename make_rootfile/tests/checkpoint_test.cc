@@ -0,0 +1,169 @@
+/**
+ *  Progress records and the resumed streamed TTree output, as used by the
+ *  resumable mode of the MakeHiggsVariablesProcessor:
+ *    - Checkpoint::write() and read() round trip.
+ *    - A streamed TTree is committed and closed, its progress record is
+ *      replaced by one of a commit that did not complete, and it is reopened
+ *      with resume = true. The output continues at the event that resumeAt()
+ *      returns for its rows. Every third event is dropped (as by the prescaled
+ *      mode), so rows and stream positions differ.
+ *  In the end, the output must hold each kept event exactly once, in order.
+ *
+ *    checkpoint_test [output_dir]
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// -- ROOT headers.
+#include "TFile.h"
+#include "TTree.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "checkpoint.h"
+#include "output_backend.h"
+
+// -- Using-declarations and global constants.
+const long kNEvents = 10;
+const long kCommittedEvents = 5;  // Before the first job ends.
+
+// ----------------------------------------------------------------------------
+bool isKept(long position) { return position % 3 != 1; }
+
+bool check(bool condition, const std::string& what) {
+  if (!condition) std::cerr << "Failed: " << what << std::endl;
+  return condition;
+}
+
+bool testRoundTrip(const std::string& file_name) {
+  Checkpoint written;
+  written.first_event = 3;
+  written.next_event = 17;
+  written.n_rows = 12;
+  written.previous_next_event = 9;
+  written.previous_n_rows = 5;
+  written.last_run = 250000;
+  written.last_event = 1234;
+  written.input_files = "a.slcio b.slcio";
+  Checkpoint read;
+  bool is_ok = check(written.write(file_name), "Checkpoint::write")
+    && check(read.read(file_name), "Checkpoint::read");
+  std::remove(file_name.c_str());
+  return is_ok
+    && check(read.first_event == written.first_event, "first_event")
+    && check(read.next_event == written.next_event, "next_event")
+    && check(read.n_rows == written.n_rows, "n_rows")
+    && check(read.previous_next_event == written.previous_next_event,
+             "previous_next_event")
+    && check(read.previous_n_rows == written.previous_n_rows,
+             "previous_n_rows")
+    && check(read.last_run == written.last_run, "last_run")
+    && check(read.last_event == written.last_event, "last_event")
+    && check(read.input_files == written.input_files, "input_files")
+    && check(read.resumeAt(12) == 17 && read.resumeAt(5) == 9
+             && read.resumeAt(7) == -1, "resumeAt")
+    && check(!read.read(file_name), "Checkpoint::read of a missing file");
+}
+
+// Fills the kept events of [begin, end) and returns the next event.
+long fillEvents(OutputBackend& output, long begin, long end, int& event,
+                std::vector<float>& pfo_e) {
+  for (long position = begin; position < end; ++position) {
+    if (!isKept(position)) continue;
+    event = static_cast<int>(position);
+    pfo_e.assign({position + .5f, position + .25f});
+    output.fill();
+  }
+  return end;
+}
+
+bool testResume(const std::string& output_dir) {
+  OutputOptions options;
+  options.file_name = output_dir + "/checkpoint_test";
+  options.tree_name = "higgs";
+  options.stream = true;
+  std::string record = Checkpoint::fileName(options.file_name);
+  int event = 0;
+  std::vector<float> pfo_e;
+  std::vector<Column> columns{
+    {"event", Column::Type::kInt, &event},
+    {"pfo_e", Column::Type::kFloatArray, &pfo_e},
+  };
+
+  // -- First job: Commits after kCommittedEvents events.
+  std::unique_ptr<OutputBackend> output = makeTreeOutput(options);
+  output->open(columns);
+  Checkpoint checkpoint;
+  checkpoint.next_event = fillEvents(*output, 0, kCommittedEvents, event,
+                                     pfo_e);
+  checkpoint.n_rows = output->nRows();
+  if (!check(checkpoint.write(record), "Checkpoint::write")
+      || !check(output->commit(), "TTree commit")) {
+    return false;
+  }
+  output->close();
+  // Killed after writing the record of the next commit, but before it.
+  checkpoint.previous_next_event = checkpoint.next_event;
+  checkpoint.previous_n_rows = checkpoint.n_rows;
+  checkpoint.next_event = kCommittedEvents + 3;
+  checkpoint.n_rows += 2;
+  checkpoint.write(record);
+
+  // -- Second job: Resumes where the output ends.
+  Checkpoint resumed;
+  options.resume = resumed.read(record);
+  output = makeTreeOutput(options);
+  output->open(columns);
+  long next_event = resumed.resumeAt(output->nRows());
+  bool is_ok = check(options.resume, "reading the progress record")
+    && check(next_event == kCommittedEvents, "resumeAt the committed event");
+  if (is_ok) fillEvents(*output, next_event, kNEvents, event, pfo_e);
+  output->close();
+  std::remove(record.c_str());
+
+  // -- Read back: Each kept event once, in order.
+  std::string file_name = options.file_name + ".root";
+  std::unique_ptr<TFile> file(TFile::Open(file_name.c_str(), "read"));
+  TTree* tree = file ? dynamic_cast<TTree*>(file->Get("higgs")) : nullptr;
+  if (is_ok && check(tree != nullptr, "reading the output")) {
+    int read_event = -1;
+    std::vector<float> read_pfo_e;
+    BranchAddresses addresses;
+    addresses.set(tree, {{"event", Column::Type::kInt, &read_event},
+                         {"pfo_e", Column::Type::kFloatArray, &read_pfo_e}});
+    Long64_t entry = 0;
+    for (long position = 0; position < kNEvents && is_ok; ++position) {
+      if (!isKept(position)) continue;
+      is_ok = check(entry < tree->GetEntries(), "a missing row")
+        && tree->GetEntry(entry++) > 0
+        && check(read_event == position, "the event of row "
+                 + std::to_string(entry - 1))
+        && check(read_pfo_e.size() == 2
+                 && read_pfo_e[0] == position + .5f, "the PFO array of row "
+                 + std::to_string(entry - 1));
+    }
+    is_ok = is_ok && check(entry == tree->GetEntries(), "no extra rows");
+    tree->ResetBranchAddresses();
+  }
+  file.reset();
+  std::remove(file_name.c_str());
+  return is_ok;
+}
+
+int main(int argc, char** argv) {
+  std::string output_dir = argc > 1 ? argv[1] : ".";
+  try {
+    bool is_ok = testRoundTrip(output_dir + "/checkpoint_test.progress");
+    is_ok = testResume(output_dir) && is_ok;
+    return is_ok ? 0 : 1;
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,61 @@
+/**
+ *  Writes one row with an int and a float column through the Parquet output
+ *  backend and reads it back with the Parquet StreamReader.
+ *
+ *    parquet_output_test [output_dir]
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// -- Apache Arrow/Parquet headers.
+#include "arrow/io/file.h"
+#include "parquet/exception.h"
+#include "parquet/stream_reader.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "output_backend.h"
+
+// ----------------------------------------------------------------------------
+int main(int argc, char** argv) {
+  std::string output_dir = argc > 1 ? argv[1] : ".";
+  OutputOptions options;
+  options.file_name = output_dir + "/parquet_output_test";
+  options.compression_algorithm = "ZSTD";
+  int n_pfos = 42;
+  float m_h = 125.5;
+  std::vector<Column> columns{
+    {"n_pfos", Column::Type::kInt, &n_pfos},
+    {"m_h", Column::Type::kFloat, &m_h},
+  };
+  try {
+    std::unique_ptr<OutputBackend> output = makeParquetOutput(options);
+    output->open(columns);
+    output->fill();
+    output->close();
+
+    std::shared_ptr<arrow::io::ReadableFile> infile;
+    PARQUET_ASSIGN_OR_THROW(infile, arrow::io::ReadableFile::Open(
+      options.file_name + ".parquet"));
+    parquet::StreamReader reader{parquet::ParquetFileReader::Open(infile)};
+    int32_t read_n_pfos = 0;
+    float read_m_h = 0;
+    reader >> read_n_pfos >> read_m_h >> parquet::EndRow;
+    bool is_ok = read_n_pfos == n_pfos && read_m_h == m_h && reader.eof();
+    std::remove((options.file_name + ".parquet").c_str());
+    if (!is_ok) {
+      std::cerr << "Read back n_pfos=" << read_n_pfos << ", m_h=" << read_m_h
+        << " instead of " << n_pfos << ", " << m_h << "." << std::endl;
+      return 1;
+    }
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,186 @@
+/**
+ *  Round trip of events through a skim file (SkimWriter, SkimReader):
+ *    - An event with an empty MC graph and no PFOs.
+ *    - An event whose arrays have an odd number of words in total, so that
+ *      the next event starts after padding.
+ *    - An event with PFOs, but no MC graph.
+ *  Every array that SkimReader::event() returns must equal the written one.
+ *  Files that were not closed or are truncated must be rejected.
+ *
+ *    skim_file_test [output_dir]
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// -- Header for this processor and other project-specific headers.
+#include "skim_file.h"
+
+// -- Using-declarations and global constants.
+// Event 1: 0 -> {1, 2}, 1 -> {2}, and only the first parent of 2.
+const std::vector<int> kPdg{25, 5, 22};
+const std::vector<int> kGeneratorStatus{2, 2, 1};
+const std::vector<int> kDaughterOffsets{0, 2, 3, 3};
+const std::vector<int> kDaughters{1, 2, 2};
+const std::vector<int> kParentOffsets{0, 0, 1, 2};
+const std::vector<int> kParents{0, 1};
+const std::vector<float> kPx{1.5f, -2.f, 0.25f};
+const std::vector<float> kPy{0.f, 3.5f, -1.f};
+const std::vector<float> kPz{10.f, -20.f, 0.5f};
+const std::vector<float> kE{12.f, 25.5f, 1.25f};
+const std::vector<int> kType{211, 22, -11};
+const std::vector<int> kMcIndex{1, -1, 2};
+
+// ----------------------------------------------------------------------------
+bool check(bool condition, const std::string& what) {
+  if (!condition) std::cerr << "Failed: " << what << std::endl;
+  return condition;
+}
+
+template <typename T>
+Span<T> span(const std::vector<T>& values, int size) {
+  return Span<T>{values.data(), size};
+}
+
+template <typename T>
+bool isEqual(const T* read, const T* written, int size) {
+  for (int i = 0; i < size; ++i) {
+    if (read[i] != written[i]) return false;
+  }
+  return true;
+}
+
+template <typename T>
+bool isEqual(const Span<T>& read, const Span<T>& written) {
+  return read.size == written.size
+    && isEqual(read.data, written.data, written.size);
+}
+
+std::vector<SkimEvent> makeEvents() {
+  std::vector<SkimEvent> events(3);
+  for (int i = 0; i < 3; ++i) {
+    events[i].run = 250000 + i;
+    events[i].event = 10 * i;
+  }
+  McGraph::Arrays& mc = events[1].mc;
+  mc.size = static_cast<int>(kPdg.size());
+  mc.n_collection = mc.size + 2;
+  mc.pdg = kPdg.data();
+  mc.generator_status = kGeneratorStatus.data();
+  mc.daughter_offsets = kDaughterOffsets.data();
+  mc.daughters = kDaughters.data();
+  mc.parent_offsets = kParentOffsets.data();
+  mc.parents = kParents.data();
+  // One PFO in event 1, all three in event 2.
+  for (int i = 1; i < 3; ++i) {
+    int n_pfos = i == 1 ? 1 : 3;
+    events[i].px = span(kPx, n_pfos);
+    events[i].py = span(kPy, n_pfos);
+    events[i].pz = span(kPz, n_pfos);
+    events[i].e = span(kE, n_pfos);
+    events[i].type = span(kType, n_pfos);
+    events[i].mc_index = span(kMcIndex, n_pfos);
+  }
+  return events;
+}
+
+bool isEqual(const SkimEvent& read, const SkimEvent& written) {
+  const McGraph::Arrays& r = read.mc;
+  const McGraph::Arrays& w = written.mc;
+  static const int kNoOffsets[1] = {0};
+  const int* daughter_offsets = w.daughter_offsets ? w.daughter_offsets
+                                                   : kNoOffsets;
+  const int* parent_offsets = w.parent_offsets ? w.parent_offsets
+                                               : kNoOffsets;
+  int n_daughters = daughter_offsets[w.size];
+  int n_parents = parent_offsets[w.size];
+  return read.run == written.run && read.event == written.event
+    && r.size == w.size && r.n_collection == w.n_collection
+    && isEqual(r.pdg, w.pdg, w.size)
+    && isEqual(r.generator_status, w.generator_status, w.size)
+    && isEqual(r.daughter_offsets, daughter_offsets, w.size + 1)
+    && isEqual(r.daughters, w.daughters, n_daughters)
+    && isEqual(r.parent_offsets, parent_offsets, w.size + 1)
+    && isEqual(r.parents, w.parents, n_parents)
+    && isEqual(read.px, written.px) && isEqual(read.py, written.py)
+    && isEqual(read.pz, written.pz) && isEqual(read.e, written.e)
+    && isEqual(read.type, written.type)
+    && isEqual(read.mc_index, written.mc_index);
+}
+
+bool testRoundTrip(const std::string& file_name) {
+  std::vector<SkimEvent> events = makeEvents();
+  SkimWriter writer(file_name);
+  for (const SkimEvent& event : events) writer.write(event);
+  writer.close();
+
+  SkimReader reader(file_name);
+  bool is_ok = check(reader.nEvents() == static_cast<long>(events.size()),
+                     "the number of events");
+  for (long i = 0; i < reader.nEvents() && is_ok; ++i) {
+    SkimEvent event = reader.event(i);
+    // The arrays start right after the event header.
+    is_ok = check(reinterpret_cast<std::uintptr_t>(event.mc.pdg) % 8 == 0,
+                  "the alignment of event " + std::to_string(i))
+      && check(isEqual(event, events[i]),
+               "the arrays of event " + std::to_string(i));
+  }
+  return is_ok;
+}
+
+bool isRejected(const std::string& file_name) {
+  try {
+    SkimReader reader(file_name);
+  } catch (std::runtime_error&) {
+    return true;
+  }
+  return false;
+}
+
+bool testRejection(const std::string& file_name,
+                   const std::string& broken_name) {
+  // Truncated: The end of the event table is missing.
+  std::string bytes;
+  {
+    std::ifstream file(file_name, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(file),
+                 std::istreambuf_iterator<char>());
+  }
+  {
+    std::ofstream file(broken_name, std::ios::binary | std::ios::trunc);
+    file.write(bytes.data(), bytes.size() - 4);
+  }
+  bool is_ok = check(isRejected(broken_name), "rejecting a truncated file");
+  // Not closed: No file header and event table.
+  {
+    SkimWriter writer(broken_name);
+    writer.write(makeEvents()[1]);
+  }
+  is_ok = check(isRejected(broken_name), "rejecting a file not closed")
+    && is_ok;
+  std::remove(broken_name.c_str());
+  return is_ok;
+}
+
+int main(int argc, char** argv) {
+  std::string output_dir = argc > 1 ? argv[1] : ".";
+  std::string file_name = output_dir + "/skim_file_test.skim";
+  try {
+    bool is_ok = testRoundTrip(file_name)
+      && testRejection(file_name, output_dir + "/skim_file_test_broken.skim");
+    std::remove(file_name.c_str());
+    return is_ok ? 0 : 1;
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    std::remove(file_name.c_str());
+    return 1;
+  }
+}
@@ -0,0 +1,154 @@
+/**
+ *  Microbenchmark of the PFO-wise kinematics of the MakeHiggsVariablesProcessor.
+ *
+ *    pfo_kinematics_benchmark [n_events]
+ *
+ *  Compares the PfoKinematics kernel with the previous implementation (one
+ *  ROOT::Math::XYZTVector per PFO, cos(Theta()) for the forward region and an
+ *  if/else chain over the PDG) on synthetic events with 50 to 800 PFOs.
+ *  Both versions run on the same momenta, the results are cross-checked.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// -- ROOT headers.
+#include "Math/Vector4D.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "pfo_kinematics.h"
+
+// -- Using-declarations and global constants.
+using Tlv = ROOT::Math::XYZTVector;
+using Clock = std::chrono::steady_clock;
+
+// ----------------------------------------------------------------------------
+struct Pfo {
+  double px, py, pz, e;
+  int pdg;
+};
+
+struct Result {
+  double px, py, pz, e;
+  int n_not_forward;
+  int n_electrons, n_muons, n_gamma, n_charged_hadrons, n_neutral_hadrons;
+};
+
+// The loop body of setHiggsKinematicInfo before the PfoKinematics kernel.
+Result reference(const std::vector<Pfo>& pfos) {
+  Result r = Result();
+  Tlv sum(0, 0, 0, 0);
+  for (const Pfo& pfo : pfos) {
+    Tlv rp_four_vector = Tlv(pfo.px, pfo.py, pfo.pz, pfo.e);
+    sum += rp_four_vector;
+    if (fabs(cos(rp_four_vector.Theta())) < 0.95) r.n_not_forward++;
+
+    int abs_pdg = abs(pfo.pdg);
+    if (abs_pdg == 11) {
+      r.n_electrons += 1;
+    } else if (abs_pdg == 22) {
+      r.n_gamma += 1;
+    } else if (abs_pdg == 13) {
+      r.n_muons += 1;
+    } else if (abs_pdg == 211 || abs_pdg == 321 || abs_pdg == 2212) {
+      r.n_charged_hadrons += 1;
+    } else if (abs_pdg == 130 || abs_pdg == 310 || abs_pdg == 2112 ||
+               abs_pdg == 3122) {
+      r.n_neutral_hadrons += 1;
+    }
+  }
+  r.px = sum.Px();
+  r.py = sum.Py();
+  r.pz = sum.Pz();
+  r.e = sum.E();
+  return r;
+}
+
+Result kernel(const std::vector<Pfo>& pfos, PfoKinematics& buffer) {
+  buffer.clear();
+  for (const Pfo& pfo : pfos) buffer.add(pfo.px, pfo.py, pfo.pz, pfo.e, pfo.pdg);
+  PfoKinematics::Sums sums = buffer.compute();
+  return {sums.px, sums.py, sums.pz, sums.e, sums.n_not_forward,
+          sums.n_per_class[PfoKinematics::kElectron],
+          sums.n_per_class[PfoKinematics::kMuon],
+          sums.n_per_class[PfoKinematics::kGamma],
+          sums.n_per_class[PfoKinematics::kChargedHadron],
+          sums.n_per_class[PfoKinematics::kNeutralHadron]};
+}
+
+bool agree(const Result& a, const Result& b) {
+  auto close = [](double x, double y) {
+    return fabs(x - y) <= 1e-9 * (1 + fabs(x) + fabs(y));
+  };
+  return close(a.px, b.px) && close(a.py, b.py) && close(a.pz, b.pz) &&
+    close(a.e, b.e) && a.n_not_forward == b.n_not_forward &&
+    a.n_electrons == b.n_electrons && a.n_muons == b.n_muons &&
+    a.n_gamma == b.n_gamma && a.n_charged_hadrons == b.n_charged_hadrons &&
+    a.n_neutral_hadrons == b.n_neutral_hadrons;
+}
+
+std::vector<std::vector<Pfo>> makeEvents(int n_events, int n_pfos) {
+  std::mt19937 rng(n_pfos);
+  std::normal_distribution<double> momentum(0, 3);
+  // Roughly the PFO type composition of the ννH events.
+  const int pdgs[] = {22, 22, 22, 211, -211, 211, 2112, 130, 11, -13, 321};
+  std::uniform_int_distribution<int> type(0, sizeof(pdgs) / sizeof(int) - 1);
+  std::vector<std::vector<Pfo>> events(n_events);
+  for (std::vector<Pfo>& event : events) {
+    for (int i = 0; i < n_pfos; ++i) {
+      double px = momentum(rng), py = momentum(rng), pz = 2 * momentum(rng);
+      event.push_back({px, py, pz, std::sqrt(px*px + py*py + pz*pz), pdgs[type(rng)]});
+    }
+  }
+  return events;
+}
+
+template <typename F>
+double nsPerEvent(const std::vector<std::vector<Pfo>>& events, F f) {
+  double checksum = 0;
+  Clock::time_point start = Clock::now();
+  for (const std::vector<Pfo>& event : events) checksum += f(event).e;
+  Clock::time_point stop = Clock::now();
+  if (checksum == -1) std::cout << checksum;  // Keep the result alive.
+  return std::chrono::duration<double, std::nano>(stop - start).count()
+    / events.size();
+}
+
+int main(int argc, char** argv) {
+  int n_events = argc > 1 ? std::atoi(argv[1]) : 20000;
+  PfoKinematics buffer;
+  auto run_reference = [](const std::vector<Pfo>& e) { return reference(e); };
+  auto run_kernel = [&buffer](const std::vector<Pfo>& e) {
+    return kernel(e, buffer);
+  };
+
+  std::cout << std::setw(8) << "n_pfos" << std::setw(16) << "reference [ns]"
+    << std::setw(16) << "kernel [ns]" << std::setw(10) << "speedup" << std::endl;
+  bool all_agree = true;
+  for (int n_pfos : {50, 100, 200, 400, 800}) {
+    std::vector<std::vector<Pfo>> events = makeEvents(n_events, n_pfos);
+    for (const std::vector<Pfo>& event : events) {
+      all_agree &= agree(reference(event), kernel(event, buffer));
+    }
+    nsPerEvent(events, run_kernel);  // Warm-up.
+    double t_reference = nsPerEvent(events, run_reference);
+    double t_kernel = nsPerEvent(events, run_kernel);
+    std::cout << std::setw(8) << n_pfos << std::fixed << std::setprecision(0)
+      << std::setw(16) << t_reference << std::setw(16) << t_kernel
+      << std::setprecision(2) << std::setw(10) << t_reference / t_kernel
+      << std::endl;
+  }
+  if (!all_agree) {
+    std::cerr << "The kernel and the reference implementation disagree."
+      << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,258 @@
+/**
+ *  Sample comparison histograms of the four data files, filled with
+ *  RDataFrame and implicit multi-threading.
+ *
+ *    vvh_compare [-j n_threads] [-d data_dir] [-o comparison.root] \
+ *                [sample ...]
+ *
+ *  For each sample (default: new old), <sample>_with_overlay.root is read with
+ *  <sample>_only_higgs.root as friend tree: Both hold the same events (as
+ *  written by vvh_runner and the fused mode). The friend rows are joined by
+ *  the (run, event) index of the files, whatever the number of threads. A
+ *  sample with an event that the join does not find (the run or event number
+ *  of the joined rows differ) is not written.
+ *  All histograms of a sample are booked lazily and filled in one event loop:
+ *    - <sample>/with_overlay/<variable> and <sample>/only_higgs/<variable>,
+ *      also per Higgs decay mode in h_decay_<mode>/.
+ *    - <sample>/overlay/<variable>: The difference of the two files (the
+ *      overlay PFOs), and overlay_nonzero/ for events with overlay PFOs.
+ *  Events are weighted with their prescale_weight (if the files have one, see
+ *  DecayModePrescales). Each histogram is divided by the sum of the weights of
+ *  its sample (so the decay mode histograms stack up to the inclusive one),
+ *  stored as sum_weights in the sample directory, next to n_events.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// -- ROOT headers.
+#include "ROOT/RDataFrame.hxx"
+#include "TDirectory.h"
+#include "TFile.h"
+#include "TH1D.h"
+#include "TParameter.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+// -- Using-declarations and global constants.
+using Clock = std::chrono::steady_clock;
+using Histo = ROOT::RDF::RResultPtr<TH1D>;
+const char* const kTreeName = "higgs";
+const char* const kFriendName = "only_higgs";
+const char* const kPrescaleWeight = "prescale_weight";
+const char* const kWeightColumn = "weight";
+
+struct Variable {
+  const char* name;
+  bool is_int;
+  int n_bins;
+  double low;
+  double high;
+};
+
+const std::vector<Variable> kVariables = {
+  {"n_pfos", true, 150, -.5, 149.5},
+  {"n_pfos_not_forward", true, 150, -.5, 149.5},
+  {"n_charged_hadrons", true, 100, -.5, 99.5},
+  {"n_neutral_hadrons", true, 50, -.5, 49.5},
+  {"n_gamma", true, 100, -.5, 99.5},
+  {"n_electrons", true, 20, -.5, 19.5},
+  {"n_muons", true, 20, -.5, 19.5},
+  {"n_isolated_leptons", true, 5, -.5, 4.5},
+  {"e_h", false, 200, -.5, 199.5},
+  {"m_h", false, 200, -.5, 199.5},
+  {"m_h_recoil", false, 260, -.5, 259.5},
+  {"cos_theta_miss", false, 200, -1, 1},
+  {"h_decay", true, 30, -.5, 29.5},
+  {"h_invisible", true, 2, -.5, 1.5},
+};
+
+// The PFO counts of the overlay, and its energy.
+const std::vector<Variable> kOverlayVariables = {
+  {"n_pfos", true, 100, -.5, 99.5},
+  {"n_charged_hadrons", true, 50, -.5, 49.5},
+  {"n_neutral_hadrons", true, 20, -.5, 19.5},
+  {"n_gamma", true, 50, -.5, 49.5},
+  {"n_electrons", true, 20, -.5, 19.5},
+  {"n_muons", true, 20, -.5, 19.5},
+  {"energy", false, 250, -.5, 249.5},
+};
+
+const int kDecayModes[] = {3, 4, 5, 13, 15, 20, 21, 22, 23, 24};
+
+// ----------------------------------------------------------------------------
+struct BookedHisto {
+  std::string directory;
+  Histo histo;
+};
+
+void bookVariables(ROOT::RDF::RNode frame, const std::vector<Variable>& variables,
+                   const std::string& column_prefix, const std::string& directory,
+                   std::vector<BookedHisto>& booked) {
+  for (const Variable& var : variables) {
+    ROOT::RDF::TH1DModel model(var.name, var.name, var.n_bins, var.low, var.high);
+    std::string column = column_prefix + var.name;
+    Histo histo = var.is_int
+      ? frame.Histo1D<int, double>(model, column, kWeightColumn)
+      : frame.Histo1D<float, double>(model, column, kWeightColumn);
+    booked.push_back({directory, histo});
+  }
+}
+
+TDirectory* makeDirectory(TFile& file, const std::string& path) {
+  TDirectory* directory = &file;
+  std::size_t begin = 0;
+  while (begin < path.size()) {
+    std::size_t end = path.find('/', begin);
+    if (end == std::string::npos) end = path.size();
+    std::string name = path.substr(begin, end - begin);
+    TDirectory* sub = directory->GetDirectory(name.c_str());
+    directory = sub ? sub : directory->mkdir(name.c_str());
+    begin = end + 1;
+  }
+  return directory;
+}
+
+// Books, fills and writes all histograms of the sample. False on bad input.
+bool compareSample(const std::string& data_dir, const std::string& sample,
+                   TFile& output) {
+  std::string with_overlay = data_dir + "/" + sample + "_with_overlay.root";
+  std::string only_higgs = data_dir + "/" + sample + "_only_higgs.root";
+  std::unique_ptr<TFile> file(TFile::Open(with_overlay.c_str(), "read"));
+  TTree* tree = file ? dynamic_cast<TTree*>(file->Get(kTreeName)) : nullptr;
+  if (!tree) {
+    std::cerr << "No " << kTreeName << " tree in " << with_overlay << "."
+      << std::endl;
+    return false;
+  }
+  // The friend rows are looked up by the (run, event) index stored in the
+  // file, also in the per-task copies of the trees with implicit MT.
+  std::string friend_name = std::string(kFriendName) + "=" + kTreeName;
+  TTree* friend_tree = tree->AddFriend(friend_name.c_str(), only_higgs.c_str())
+    ? tree->GetFriend(kFriendName) : nullptr;
+  if (!friend_tree || friend_tree->GetEntries() != tree->GetEntries()) {
+    std::cerr << only_higgs << " is missing or not aligned with "
+      << with_overlay << "." << std::endl;
+    return false;
+  }
+
+  ROOT::RDataFrame data_frame(*tree);
+  // Events of prescaled decay modes count with their prescale weight.
+  ROOT::RDF::RNode frame = tree->GetBranch(kPrescaleWeight)
+    ? ROOT::RDF::RNode(data_frame.Define(kWeightColumn,
+        [](float weight) { return static_cast<double>(weight); },
+        {kPrescaleWeight}))
+    : ROOT::RDF::RNode(data_frame.Define(kWeightColumn, []() { return 1.; }));
+  std::string friend_prefix = std::string(kFriendName) + ".";
+  auto overlay = frame
+    .Define("overlay_n_pfos", [](int a, int b) { return a - b; },
+            {"n_pfos", friend_prefix + "n_pfos"})
+    .Define("overlay_n_charged_hadrons", [](int a, int b) { return a - b; },
+            {"n_charged_hadrons", friend_prefix + "n_charged_hadrons"})
+    .Define("overlay_n_neutral_hadrons", [](int a, int b) { return a - b; },
+            {"n_neutral_hadrons", friend_prefix + "n_neutral_hadrons"})
+    .Define("overlay_n_gamma", [](int a, int b) { return a - b; },
+            {"n_gamma", friend_prefix + "n_gamma"})
+    .Define("overlay_n_electrons", [](int a, int b) { return a - b; },
+            {"n_electrons", friend_prefix + "n_electrons"})
+    .Define("overlay_n_muons", [](int a, int b) { return a - b; },
+            {"n_muons", friend_prefix + "n_muons"})
+    .Define("overlay_energy", [](float a, float b) { return a - b; },
+            {"e_h", friend_prefix + "e_h"});
+
+  std::vector<BookedHisto> booked;
+  auto n_events = frame.Count();
+  auto sum_weights = frame.Sum<double>(kWeightColumn);
+  auto n_misaligned = frame
+    .Filter([](int run, int event, int friend_run, int friend_event) {
+              return run != friend_run || event != friend_event; },
+            {"run", "event", friend_prefix + "run", friend_prefix + "event"})
+    .Count();
+  bookVariables(frame, kVariables, "", sample + "/with_overlay", booked);
+  bookVariables(frame, kVariables, friend_prefix, sample + "/only_higgs", booked);
+  for (int mode : kDecayModes) {
+    auto decay = frame.Filter([mode](int h_decay) { return h_decay == mode; },
+                              {"h_decay"});
+    std::string subdir = "/h_decay_" + std::to_string(mode);
+    bookVariables(decay, kVariables, "", sample + "/with_overlay" + subdir, booked);
+    bookVariables(decay, kVariables, friend_prefix,
+                  sample + "/only_higgs" + subdir, booked);
+  }
+  bookVariables(overlay, kOverlayVariables, "overlay_", sample + "/overlay",
+                booked);
+  auto nonzero = overlay.Filter([](int n_pfos) { return n_pfos > 0; },
+                                {"overlay_n_pfos"});
+  bookVariables(nonzero, kOverlayVariables, "overlay_",
+                sample + "/overlay_nonzero", booked);
+
+  // The first result triggers the event loop that fills all of them.
+  Clock::time_point start = Clock::now();
+  Long64_t n_sample_events = *n_events;
+  std::chrono::duration<double> seconds = Clock::now() - start;
+  std::cout << sample << ": " << n_sample_events << " events, "
+    << booked.size() << " histograms in " << seconds.count() << " s."
+    << std::endl;
+  if (*n_misaligned > 0) {
+    std::cerr << *n_misaligned << " rows of " << only_higgs << " differ in run "
+      << "or event number from " << with_overlay << "." << std::endl;
+    return false;
+  }
+
+  for (BookedHisto& entry : booked) {
+    if (*sum_weights > 0) entry.histo->Scale(1. / *sum_weights);
+    makeDirectory(output, entry.directory)->WriteTObject(entry.histo.GetPtr());
+  }
+  TParameter<Long64_t> n_events_parameter("n_events", n_sample_events);
+  makeDirectory(output, sample)->WriteTObject(&n_events_parameter);
+  TParameter<double> sum_weights_parameter("sum_weights", *sum_weights);
+  makeDirectory(output, sample)->WriteTObject(&sum_weights_parameter);
+  return true;
+}
+
+int main(int argc, char** argv) {
+  int n_threads = std::thread::hardware_concurrency();
+  std::string data_dir{"."};
+  std::string output_file{"comparison.root"};
+  std::vector<std::string> samples;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-j" && i + 1 < argc) {
+      n_threads = std::atoi(argv[++i]);
+    } else if (arg == "-d" && i + 1 < argc) {
+      data_dir = argv[++i];
+    } else if (arg == "-o" && i + 1 < argc) {
+      output_file = argv[++i];
+    } else if (arg[0] == '-') {
+      n_threads = 0;
+      break;
+    } else {
+      samples.push_back(arg);
+    }
+  }
+  if (n_threads < 1) {
+    std::cerr << "Usage: " << argv[0] << " [-j n_threads] [-d data_dir] "
+      << "[-o comparison.root] [sample ...]" << std::endl;
+    return 1;
+  }
+  if (samples.empty()) samples = {"new", "old"};
+  ROOT::EnableImplicitMT(n_threads);
+
+  TFile output(output_file.c_str(), "recreate");
+  if (output.IsZombie()) {
+    std::cerr << "Could not create " << output_file << "." << std::endl;
+    return 1;
+  }
+  bool is_complete = true;
+  for (const std::string& sample : samples) {
+    if (!compareSample(data_dir, sample, output)) is_complete = false;
+  }
+  output.Close();
+  return is_complete ? 0 : 1;
+}
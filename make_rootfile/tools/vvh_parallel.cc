@@ -0,0 +1,362 @@
+/**
+ *  In-process parallel event loop for a Marlin steering file.
+ *
+ *    vvh_parallel [-j n_threads] [--select-collections [--keep=a,b,...]]
+ *                 [--read-ahead=k] steering.xml
+ *
+ *  Each worker thread owns one clone of every active processor of the
+ *  steering file. It takes whole LCIO files from a shared queue and reads them
+ *  with its own LCReader, so no event is ever shared between threads.
+ *  The processors of this project keep all per-event state in the clone.
+ *  Clones that write the same output file merge their parts in end(), see
+ *  OutputMerger.
+ *
+ *  With --select-collections, LCIO only unpacks the collections that the
+ *  processors read, all others are skipped. The processors of this project
+ *  declare them (CollectionConsumer). For other processors, the input
+ *  collections set in the steering file are taken. Collections that are only
+ *  reached through references (e.g. the tracks and clusters of the PFOs for
+ *  the IsolatedLeptonTaggingProcessor) must be added with --keep.
+ *
+ *  With --read-ahead=k, each worker reads and decodes its LCIO file on a
+ *  second thread, up to k events ahead of the processors (needs LCIO 2.13 or
+ *  newer, whose MT::LCReader hands out the ownership of the events). The I/O
+ *  and decompression then overlap with processEvent. The event throughput is
+ *  printed at the end.
+ *
+ *  Processor libraries are loaded from MARLIN_DLL, as in Marlin.
+ *  Not supported wrt. Marlin: processor conditions, MaxRecordNumber and
+ *  SkipNEvents.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// -- ROOT headers.
+#include "TROOT.h"
+
+// -- LCIO headers.
+#include "IO/LCEventListener.h"
+#include "IO/LCReader.h"
+#include "IO/LCRunListener.h"
+#include "IOIMPL/LCFactory.h"
+#include "lcio.h"
+#if LCIO_VERSION_GE(2, 13)
+#include "MT/LCReader.h"
+#include "MT/LCReaderListener.h"
+#endif
+
+// -- Marlin headers.
+#include "marlin/Exceptions.h"
+#include "marlin/Global.h"
+#include "marlin/ProcessorLoader.h"
+#include "marlin/ProcessorMgr.h"
+#include "marlin/XMLParser.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "bounded_queue.h"
+#include "collection_consumer.h"
+#include "marlin_compat.h"
+
+// ----------------------------------------------------------------------------
+class FileQueue {
+ public:
+  explicit FileQueue(const std::vector<std::string>& files) : files_(files) {}
+  // False once all files are taken or the processing was stopped.
+  bool next(std::string& file) {
+    if (stopped_) return false;
+    std::size_t i = next_++;
+    if (i >= files_.size()) return false;
+    file = files_[i];
+    return true;
+  }
+  void stop() { stopped_ = true; }
+  bool stopped() const { return stopped_; }
+
+ private:
+  const std::vector<std::string> files_;
+  std::atomic<std::size_t> next_{0};
+  std::atomic<bool> stopped_{false};
+};
+
+#if LCIO_VERSION_GE(2, 13)
+// The events and run headers of a file, in their order in the file.
+struct Record {
+  std::shared_ptr<EVENT::LCEvent> event;
+  std::shared_ptr<EVENT::LCRunHeader> run_header;
+};
+
+class ReadAheadListener : public MT::LCReaderListener {
+ public:
+  struct Cancelled {};  // The consumer stopped, thrown to end readStream.
+
+  explicit ReadAheadListener(BoundedQueue<Record>& records) : records_(records) {}
+  void processEvent(std::shared_ptr<EVENT::LCEvent> event) {
+    if (!records_.push({event, nullptr})) throw Cancelled();
+  }
+  void processRunHeader(std::shared_ptr<EVENT::LCRunHeader> run_header) {
+    if (!records_.push({nullptr, run_header})) throw Cancelled();
+  }
+
+ private:
+  BoundedQueue<Record>& records_;
+};
+#endif
+
+class Worker : public IO::LCEventListener, public IO::LCRunListener {
+ public:
+  Worker() = default;
+  Worker(const Worker&) = delete;
+  Worker& operator=(const Worker&) = delete;
+  ~Worker() { for (marlin::Processor* p : processors) delete p; }
+
+  void processEvent(EVENT::LCEvent* event) {
+    for (marlin::Processor* p : processors) {
+      try {
+        p->processEvent(event);
+        p->check(event);
+      } catch (marlin::SkipEventException&) {
+        break;
+      }
+    }
+    ++n_events;
+  }
+  void modifyEvent(EVENT::LCEvent*) {}
+  void processRunHeader(EVENT::LCRunHeader* run) {
+    for (marlin::Processor* p : processors) p->processRunHeader(run);
+  }
+  void modifyRunHeader(EVENT::LCRunHeader*) {}
+
+  void run(FileQueue& queue) {
+    std::unique_ptr<IO::LCReader> reader(
+      IOIMPL::LCFactory::getInstance()->createLCReader());
+    reader->registerLCEventListener(this);
+    reader->registerLCRunListener(this);
+    if (!read_collections.empty()) {
+      reader->setReadCollectionNames(read_collections);
+    }
+    std::string file;
+    while (queue.next(file)) {
+      try {
+        if (read_ahead > 0) {
+          readAhead(file);
+          continue;
+        }
+        reader->open(file);
+        reader->readStream();
+        reader->close();
+      } catch (marlin::StopProcessingException&) {
+        std::cerr << "A processor requested to stop the processing." << std::endl;
+        queue.stop();
+      } catch (std::exception& e) {
+        std::cerr << "Processing " << file << " failed: " << e.what() << std::endl;
+        queue.stop();
+      }
+    }
+  }
+
+  std::vector<marlin::Processor*> processors{};
+  std::vector<std::string> read_collections{};  // Empty: All collections.
+  int read_ahead = 0;  // Events decoded ahead on a second thread, 0: Off.
+  long n_events = 0;
+
+ private:
+#if LCIO_VERSION_GE(2, 13)
+  void readAhead(const std::string& file) {
+    BoundedQueue<Record> records(read_ahead);
+    std::thread reader_thread([this, &file, &records] {
+      try {
+        MT::LCReader reader(0);
+        if (!read_collections.empty()) {
+          reader.setReadCollectionNames(read_collections);
+        }
+        reader.open(file);
+        ReadAheadListener listener(records);
+        reader.readStream({&listener});
+        reader.close();
+        records.close();
+      } catch (ReadAheadListener::Cancelled&) {
+      } catch (...) {
+        records.fail(std::current_exception());
+      }
+    });
+    try {
+      Record record;
+      while (records.pop(record)) {
+        if (record.event) {
+          processEvent(record.event.get());
+        } else {
+          processRunHeader(record.run_header.get());
+        }
+        record = Record();  // Free the event before waiting for the next.
+      }
+    } catch (...) {
+      records.cancel();
+      reader_thread.join();
+      throw;
+    }
+    reader_thread.join();
+  }
+#else
+  void readAhead(const std::string&) {}  // main() switches it off.
+#endif
+};
+
+// ----------------------------------------------------------------------------
+std::vector<std::string> split(const char* text, char delimiter) {
+  std::vector<std::string> parts;
+  if (!text) return parts;
+  std::stringstream stream(text);
+  std::string part;
+  while (std::getline(stream, part, delimiter)) {
+    if (!part.empty()) parts.push_back(part);
+  }
+  return parts;
+}
+
+// The union of the collections that the processors read, and the extra ones.
+std::vector<std::string> readCollections(
+    const std::vector<marlin::Processor*>& processors,
+    std::vector<std::string> collections) {
+  for (marlin::Processor* p : processors) {
+    CollectionConsumer* consumer = dynamic_cast<CollectionConsumer*>(p);
+    if (consumer) {
+      std::vector<std::string> names = consumer->inputCollections();
+      collections.insert(collections.end(), names.begin(), names.end());
+      continue;
+    }
+    EVENT::StringVec keys;
+    raw(p->parameters())->getStringKeys(keys);
+    for (const std::string& key : keys) {
+      if (!p->isInputCollectionName(key)) continue;
+      EVENT::StringVec names;
+      raw(p->parameters())->getStringVals(key, names);
+      collections.insert(collections.end(), names.begin(), names.end());
+    }
+  }
+  std::sort(collections.begin(), collections.end());
+  collections.erase(std::unique(collections.begin(), collections.end()),
+                    collections.end());
+  return collections;
+}
+
+int main(int argc, char** argv) {
+  unsigned n_threads = std::thread::hardware_concurrency();
+  std::string steering_file{""};
+  bool select_collections = false;
+  int read_ahead = 0;
+  std::vector<std::string> kept_collections;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-j" && i + 1 < argc) {
+      n_threads = std::atoi(argv[++i]);
+    } else if (arg == "--select-collections") {
+      select_collections = true;
+    } else if (arg.compare(0, 13, "--read-ahead=") == 0) {
+      read_ahead = std::atoi(arg.c_str() + 13);
+    } else if (arg.compare(0, 7, "--keep=") == 0) {
+      kept_collections = split(arg.c_str() + 7, ',');
+    } else {
+      steering_file = arg;
+    }
+  }
+  if (steering_file.empty() || n_threads == 0) {
+    std::cerr << "Usage: " << argv[0] << " [-j n_threads] "
+      << "[--select-collections [--keep=a,b,...]] [--read-ahead=k] "
+      << "steering.xml" << std::endl;
+    return 1;
+  }
+#if !LCIO_VERSION_GE(2, 13)
+  if (read_ahead > 0) {
+    std::cerr << "Reading ahead needs LCIO 2.13 or newer. The events are read "
+      << "synchronously." << std::endl;
+    read_ahead = 0;
+  }
+#endif
+
+  std::vector<std::string> libraries = split(std::getenv("MARLIN_DLL"), ':');
+  marlin::ProcessorLoader loader(libraries.begin(), libraries.end());
+
+  marlin::XMLParser parser(steering_file);
+  parser.parse();
+  auto global = parser.getParameters("Global");
+  setGlobal(marlin::Global::parameters, global);
+  EVENT::StringVec input_files;
+  EVENT::StringVec active_processors;
+  raw(global)->getStringVals("LCIOInputFiles", input_files);
+  raw(global)->getStringVals("ActiveProcessors", active_processors);
+  if (raw(global)->getIntVal("SkipNEvents") > 0 ||
+      raw(global)->getIntVal("MaxRecordNumber") > 0) {
+    std::cerr << "SkipNEvents and MaxRecordNumber are ignored by "
+      << argv[0] << "." << std::endl;
+  }
+  n_threads = std::min<unsigned>(n_threads, input_files.size());
+  if (n_threads == 0) {
+    std::cerr << "No LCIO input files are given." << std::endl;
+    return 1;
+  }
+
+  ROOT::EnableThreadSafety();
+  std::vector<std::unique_ptr<Worker>> workers;
+  for (unsigned w = 0; w < n_threads; ++w) {
+    workers.emplace_back(new Worker());
+    for (const std::string& name : active_processors) {
+      auto parameters = parser.getParameters(name);
+      std::string type = raw(parameters)->getStringVal("ProcessorType");
+      marlin::Processor* prototype =
+        marlin::ProcessorMgr::instance()->getProcessor(type);
+      if (!prototype) {
+        std::cerr << "Unknown processor type " << type << "." << std::endl;
+        return 1;
+      }
+      marlin::Processor* processor = prototype->newProcessor();
+      setProcessorName(processor, name);
+      processor->setProcessorParameters(raw(parameters));
+      workers.back()->processors.push_back(processor);
+    }
+    workers.back()->read_ahead = read_ahead;
+  }
+  if (select_collections) {
+    // The same for all workers.
+    std::vector<std::string> read_collections =
+      readCollections(workers.front()->processors, kept_collections);
+    std::cout << "Only the collections";
+    for (const std::string& name : read_collections) std::cout << " " << name;
+    std::cout << " are read." << std::endl;
+    for (auto& worker : workers) worker->read_collections = read_collections;
+  }
+  // All clones join their output mergers here, before any event is seen.
+  for (auto& worker : workers) {
+    for (marlin::Processor* p : worker->processors) p->init();
+  }
+
+  FileQueue queue(input_files);
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> threads;
+  for (auto& worker : workers) {
+    threads.emplace_back(&Worker::run, worker.get(), std::ref(queue));
+  }
+  for (std::thread& thread : threads) thread.join();
+  std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+  long n_events = 0;
+  for (auto& worker : workers) {
+    for (marlin::Processor* p : worker->processors) p->end();
+    n_events += worker->n_events;
+  }
+  std::cout << "Processed " << n_events << " events from " << input_files.size()
+    << " files with " << n_threads << " threads in " << seconds.count()
+    << " s (" << n_events / seconds.count() << " events/s, without init and "
+    << "end)." << std::endl;
+  return queue.stopped() ? 1 : 0;
+}
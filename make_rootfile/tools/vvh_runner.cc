@@ -0,0 +1,391 @@
+/**
+ *  Local multi-process runner: Produces the four data files of the comparison
+ *  on one machine, without a batch system and without a manual hadd step.
+ *
+ *    vvh_runner [-j n_workers] [-o output_dir] steering.xml \
+ *               new=<file list> old=<file list>
+ *
+ *  A file list is a text file with one LCIO file path per line.
+ *  Each LCIO file is one Marlin job. The jobs are distributed over per-worker
+ *  queues. A worker that runs out of jobs steals from the back of the fullest
+ *  other queue, so that a few slow files do not stall the run.
+ *  The two rootfiles of each finished job are appended right away to
+ *  <output_dir>/<sample>_with_overlay.root and <sample>_only_higgs.root.
+ *  Both files of a sample are appended in the same job order, so their rows
+ *  stay aligned. Besides the higgs tree, all other trees of the job outputs
+ *  (the perf and metadata profiles) are appended as well.
+ *
+ *  The job outputs are redirected with Marlin command line parameters, the
+ *  names of the two MakeHiggsVariablesProcessor instances can be changed with
+ *  --with-overlay=<name> and --only-higgs=<name>. With --fused, the steering
+ *  file has a single instance with FusedOverlayRemoval (the --with-overlay one).
+ *
+ *  With --retries=n, a failed job is rerun up to n times. If the steering file
+ *  sets CheckpointEvents, a rerun (also of a job left over from an earlier,
+ *  killed vvh_runner call) resumes its outputs: The events committed to both
+ *  outputs are skipped with SkipNEvents.
+ *
+ *  The shard files of vvh_shards can be given in place of the file lists:
+ *  Each shard (an event range of an LCIO file) is then one Marlin job, limited
+ *  with SkipNEvents and MaxRecordNumber.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <spawn.h>
+#include <string>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <thread>
+#include <vector>
+
+// -- ROOT headers.
+#include "TFile.h"
+#include "TKey.h"
+#include "TList.h"
+#include "TROOT.h"
+#include "TTree.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "checkpoint.h"
+
+// -- Using-declarations and global constants.
+extern char** environ;
+const char* const kTreeName = "higgs";
+
+// ----------------------------------------------------------------------------
+struct Job {
+  std::string sample;
+  int index;
+  std::string lcio_file;
+  long first_event;
+  long n_events;     // -1: Up to the end of the file.
+  long max_records;  // Including the run headers, -1: No limit.
+};
+
+// One queue per worker. The owner takes jobs from the front, thieves from
+// the back.
+class WorkStealingQueues {
+ public:
+  WorkStealingQueues(const std::vector<Job>& jobs, int n_workers)
+    : queues_(n_workers) {
+    for (std::size_t i = 0; i < jobs.size(); ++i) {
+      queues_[i % n_workers].jobs.push_back(jobs[i]);
+    }
+  }
+
+  bool next(int worker, Job& job) {
+    {
+      Queue& own = queues_[worker];
+      std::lock_guard<std::mutex> lock(own.mutex);
+      if (!own.jobs.empty()) {
+        job = own.jobs.front();
+        own.jobs.pop_front();
+        return true;
+      }
+    }
+    // Steal from the queue with the most jobs left.
+    while (true) {
+      int victim = -1;
+      std::size_t most = 0;
+      for (std::size_t q = 0; q < queues_.size(); ++q) {
+        std::lock_guard<std::mutex> lock(queues_[q].mutex);
+        if (queues_[q].jobs.size() > most) {
+          most = queues_[q].jobs.size();
+          victim = q;
+        }
+      }
+      if (victim < 0) return false;
+      Queue& other = queues_[victim];
+      std::lock_guard<std::mutex> lock(other.mutex);
+      if (other.jobs.empty()) continue;  // Someone else was faster.
+      job = other.jobs.back();
+      other.jobs.pop_back();
+      return true;
+    }
+  }
+
+ private:
+  struct Queue {
+    std::mutex mutex{};
+    std::deque<Job> jobs{};
+  };
+  std::vector<Queue> queues_;
+};
+
+// Appends the job outputs to the final files, one job at a time.
+class StreamMerger {
+ public:
+  explicit StreamMerger(const std::string& output_dir)
+    : output_dir_(output_dir) {}
+  StreamMerger(const StreamMerger&) = delete;
+  StreamMerger& operator=(const StreamMerger&) = delete;
+
+  void append(const std::string& sample,
+              const std::string& with_overlay, const std::string& only_higgs) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    appendFile(sample + "_with_overlay", with_overlay);
+    appendFile(sample + "_only_higgs", only_higgs);
+  }
+
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto& output : outputs_) {
+      output.second.file->cd();
+      for (auto& tree : output.second.trees) {
+        // Random access by (run, event), e.g. to join the two files of a sample.
+        if (tree.second->GetBranch("run")) {
+          tree.second->BuildIndex("run", "event");
+        }
+        tree.second->Write("", TObject::kOverwrite);
+      }
+      output.second.file->Close();
+      std::cout << output.first << ".root: " << output.second.n_entries
+        << " events." << std::endl;
+      delete output.second.file;
+    }
+    outputs_.clear();
+  }
+
+ private:
+  struct Output {
+    TFile* file;
+    std::map<std::string, TTree*> trees;  // Owned by the file.
+    long n_entries;
+  };
+
+  // Appends every tree of the part file: The higgs tree and the perf and
+  // metadata trees of the job (one row per processor).
+  void appendFile(const std::string& name, const std::string& part_name) {
+    std::unique_ptr<TFile> part(TFile::Open(part_name.c_str(), "read"));
+    TTree* part_tree = part ? dynamic_cast<TTree*>(part->Get(kTreeName)) : nullptr;
+    if (!part_tree) {
+      std::cerr << "No " << kTreeName << " tree in " << part_name << "."
+        << std::endl;
+      return;
+    }
+    auto it = outputs_.find(name);
+    if (it == outputs_.end()) {
+      std::string file_name = output_dir_ + "/" + name + ".root";
+      TFile* file = new TFile(file_name.c_str(), "recreate");
+      it = outputs_.insert({name, Output{file, {}, 0}}).first;
+    }
+    Output& output = it->second;
+    std::set<std::string> appended;
+    TIter next(part->GetListOfKeys());
+    while (TKey* key = static_cast<TKey*>(next())) {
+      // Each tree once, Get() returns its latest cycle.
+      if (std::string(key->GetClassName()) != "TTree" ||
+          !appended.insert(key->GetName()).second) {
+        continue;
+      }
+      TTree* tree = dynamic_cast<TTree*>(part->Get(key->GetName()));
+      if (!tree) continue;
+      output.file->cd();
+      TTree*& output_tree = output.trees[key->GetName()];
+      if (!output_tree) {
+        output_tree = tree->CloneTree(0);
+        output_tree->SetDirectory(output.file);
+      }
+      long n_copied = output_tree->CopyEntries(tree);
+      if (std::string(key->GetName()) == kTreeName) output.n_entries += n_copied;
+    }
+    part->Close();
+    std::remove(part_name.c_str());
+    std::string base = part_name.substr(0, part_name.size() - 5);  // ".root"
+    std::remove(Checkpoint::fileName(base).c_str());
+  }
+
+  std::mutex mutex_{};
+  std::string output_dir_;
+  std::map<std::string, Output> outputs_{};
+};
+
+// ----------------------------------------------------------------------------
+int runMarlin(const std::vector<std::string>& args, const std::string& log) {
+  std::vector<char*> argv;
+  for (const std::string& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+  argv.push_back(nullptr);
+
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  posix_spawn_file_actions_addopen(&actions, 1, log.c_str(),
+                                   O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  posix_spawn_file_actions_adddup2(&actions, 1, 2);
+  pid_t pid;
+  int status = posix_spawnp(&pid, argv[0], &actions, nullptr, argv.data(), environ);
+  posix_spawn_file_actions_destroy(&actions);
+  if (status != 0) return status;
+  if (waitpid(pid, &status, 0) < 0) return -1;
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+}
+
+// The events that a resumed job can skip: Those committed to both outputs.
+long committedEvents(const std::string& lcio_file,
+                     const std::vector<std::string>& outputs) {
+  long committed = -1;
+  for (const std::string& output : outputs) {
+    Checkpoint checkpoint;
+    // The processor lists the input files separated by blanks.
+    if (!checkpoint.read(Checkpoint::fileName(output))
+        || checkpoint.input_files != lcio_file + " ") {
+      return 0;
+    }
+    // The record is written before the output is committed: Only the
+    // previous commit is certain.
+    if (committed < 0 || checkpoint.previous_next_event < committed) {
+      committed = checkpoint.previous_next_event;
+    }
+  }
+  return committed < 0 ? 0 : committed;
+}
+
+// The MaxRecordNumber of a shard that resumes at the event skip. Only a
+// shard that starts at the first event also reads the run headers.
+long remainingRecords(const Job& job, long skip) {
+  if (job.max_records < 0) return -1;
+  long run_headers = skip == 0 ? job.max_records - job.n_events : 0;
+  return job.first_event + job.n_events - skip + run_headers;
+}
+
+// A line is either an LCIO file or a shard of vvh_shards:
+// <lcio file> <first event> <n events> <max record number>.
+std::vector<Job> readJobList(const std::string& sample,
+                             const std::string& list_name) {
+  std::vector<Job> jobs;
+  std::ifstream list(list_name);
+  std::string line;
+  while (std::getline(list, line)) {
+    if (line.empty() || line[0] == '#') continue;
+    Job job{sample, static_cast<int>(jobs.size()), line, 0, -1, -1};
+    std::istringstream fields(line);
+    std::string lcio_file;
+    if (fields >> lcio_file >> job.first_event >> job.n_events >> job.max_records) {
+      job.lcio_file = lcio_file;
+    } else {
+      job.first_event = 0;
+      job.n_events = -1;
+      job.max_records = -1;
+    }
+    jobs.push_back(job);
+  }
+  return jobs;
+}
+
+int main(int argc, char** argv) {
+  int n_workers = std::thread::hardware_concurrency();
+  std::string output_dir{"."};
+  std::string steering_file{""};
+  std::string with_overlay_processor{"MakeHiggsVariablesProcessor_001"};
+  std::string only_higgs_processor{"MakeHiggsVariablesProcessor_003"};
+  bool fused = false;
+  int n_retries = 0;
+  std::vector<Job> jobs;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    std::size_t eq = arg.find('=');
+    if (arg == "-j" && i + 1 < argc) {
+      n_workers = std::atoi(argv[++i]);
+    } else if (arg == "-o" && i + 1 < argc) {
+      output_dir = argv[++i];
+    } else if (arg.compare(0, 15, "--with-overlay=") == 0) {
+      with_overlay_processor = arg.substr(15);
+    } else if (arg.compare(0, 13, "--only-higgs=") == 0) {
+      only_higgs_processor = arg.substr(13);
+    } else if (arg == "--fused") {
+      fused = true;
+    } else if (arg.compare(0, 10, "--retries=") == 0) {
+      n_retries = std::atoi(arg.c_str() + 10);
+    } else if (eq != std::string::npos) {
+      std::vector<Job> sample_jobs = readJobList(arg.substr(0, eq),
+                                                 arg.substr(eq + 1));
+      jobs.insert(jobs.end(), sample_jobs.begin(), sample_jobs.end());
+    } else {
+      steering_file = arg;
+    }
+  }
+  if (steering_file.empty() || jobs.empty() || n_workers < 1) {
+    std::cerr << "Usage: " << argv[0] << " [-j n_workers] [-o output_dir] "
+      << "[--retries=n] steering.xml new=<file or shard list> "
+      << "old=<file or shard list>"
+      << std::endl;
+    return 1;
+  }
+  std::string only_higgs_parameter = "OutputRootFile";
+  if (fused) {
+    only_higgs_processor = with_overlay_processor;
+    only_higgs_parameter = "HiggsOnlyOutputRootFile";
+  }
+
+  std::string part_dir = output_dir + "/parts";
+  mkdir(output_dir.c_str(), 0755);
+  mkdir(part_dir.c_str(), 0755);
+  ROOT::EnableThreadSafety();
+
+  WorkStealingQueues queues(jobs, n_workers);
+  StreamMerger merger(output_dir);
+  std::mutex failed_mutex;
+  std::vector<Job> failed;
+  auto work = [&](int worker) {
+    Job job;
+    while (queues.next(worker, job)) {
+      std::string base = part_dir + "/" + job.sample + "_"
+        + std::to_string(job.index);
+      int status = 0;
+      for (int attempt = 0; attempt <= n_retries; ++attempt) {
+        long skip = std::max(job.first_event, committedEvents(job.lcio_file,
+          {base + "_with_overlay", base + "_only_higgs"}));
+        if (job.n_events > 0) {
+          // MaxRecordNumber=0 reads all records. A completed shard rereads its
+          // last event, which the processor skips as committed.
+          skip = std::min(skip, job.first_event + job.n_events - 1);
+        }
+        status = runMarlin({
+          "Marlin",
+          "--global.LCIOInputFiles=" + job.lcio_file,
+          "--global.SkipNEvents=" + std::to_string(skip),
+          "--global.MaxRecordNumber="
+            + std::to_string(remainingRecords(job, skip)),
+          "--" + with_overlay_processor + ".OutputRootFile=" + base + "_with_overlay",
+          "--" + only_higgs_processor + "." + only_higgs_parameter + "="
+            + base + "_only_higgs",
+          steering_file}, base + ".log");
+        if (status == 0) break;
+      }
+      if (status != 0) {
+        std::lock_guard<std::mutex> lock(failed_mutex);
+        failed.push_back(job);
+        std::cerr << "Job " << job.lcio_file << " failed (" << status
+          << "), see " << base << ".log." << std::endl;
+        continue;
+      }
+      merger.append(job.sample, base + "_with_overlay.root",
+                    base + "_only_higgs.root");
+      std::remove((base + ".log").c_str());
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int w = 0; w < n_workers; ++w) threads.emplace_back(work, w);
+  for (std::thread& thread : threads) thread.join();
+  merger.close();
+
+  if (!failed.empty()) {
+    std::cerr << failed.size() << " of " << jobs.size() << " jobs failed."
+      << std::endl;
+    return 1;
+  }
+  return 0;
+}
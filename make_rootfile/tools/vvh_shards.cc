@@ -0,0 +1,188 @@
+/**
+ *  Shard planner: Splits the LCIO files of the samples into jobs with about
+ *  the same number of events, instead of a fixed number of files per job.
+ *
+ *    vvh_shards [-j n_threads] [-n n_shards | --events=n] [-o output_dir] \
+ *               new=<file list> old=<file list>
+ *
+ *  A file list is a text file with one LCIO file path per line.
+ *  The event and run header counts of each file are taken from its random
+ *  access records (LCIO scans the run and event records of files without
+ *  them). No event is decoded, the files are opened by n_threads in parallel.
+ *
+ *  All shards of all samples get at most --events events (default: the total
+ *  divided by n_shards, 100 shards by default). A shard never spans two files:
+ *  A larger file is split into near-equal event ranges. For each sample,
+ *  <output_dir>/<sample>.shards lists one shard per line:
+ *
+ *    <lcio file> <first event> <n events> <max record number>
+ *
+ *  A shard is run with the Marlin global parameters LCIOInputFiles,
+ *  SkipNEvents (the first event) and MaxRecordNumber. Marlin counts the run
+ *  headers as records, too. They are assumed to precede the events of a file
+ *  (as in the ILD productions), so they only count for its first shard.
+ *  vvh_runner accepts the shard files in place of the file lists.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// -- LCIO headers.
+#include "IO/LCReader.h"
+#include "IOIMPL/LCFactory.h"
+
+// -- Using-declarations and global constants.
+const int kDefaultShards = 100;
+
+// ----------------------------------------------------------------------------
+struct FileCounts {
+  std::string sample;
+  std::string lcio_file;
+  long n_events = -1;  // -1: The file could not be read.
+  long n_runs = 0;
+};
+
+struct Shard {
+  std::string lcio_file;
+  long first_event;
+  long n_events;
+  long max_records;
+};
+
+std::vector<std::string> readFileList(const std::string& list_name) {
+  std::vector<std::string> files;
+  std::ifstream list(list_name);
+  std::string line;
+  while (std::getline(list, line)) {
+    if (!line.empty() && line[0] != '#') files.push_back(line);
+  }
+  return files;
+}
+
+void countEvents(std::vector<FileCounts>& files, int n_threads) {
+  std::atomic<std::size_t> next{0};
+  auto work = [&files, &next]() {
+    std::unique_ptr<IO::LCReader> reader(
+      IOIMPL::LCFactory::getInstance()->createLCReader(IO::LCReader::directAccess));
+    for (std::size_t i = next++; i < files.size(); i = next++) {
+      try {
+        reader->open(files[i].lcio_file);
+        files[i].n_events = reader->getNumberOfEvents();
+        files[i].n_runs = reader->getNumberOfRuns();
+        reader->close();
+      } catch (std::exception& e) {
+        std::cerr << files[i].lcio_file << ": " << e.what() << std::endl;
+      }
+    }
+  };
+  std::vector<std::thread> threads;
+  for (int t = 0; t < n_threads; ++t) threads.emplace_back(work);
+  for (std::thread& thread : threads) thread.join();
+}
+
+// Near-equal event ranges of at most max_events each.
+std::vector<Shard> splitFile(const FileCounts& file, long max_events) {
+  std::vector<Shard> shards;
+  long n_shards = (file.n_events + max_events - 1) / max_events;
+  long first_event = 0;
+  for (long s = 0; s < n_shards; ++s) {
+    long n_events = file.n_events / n_shards
+      + (s < file.n_events % n_shards ? 1 : 0);
+    long max_records = n_events + (first_event == 0 ? file.n_runs : 0);
+    shards.push_back({file.lcio_file, first_event, n_events, max_records});
+    first_event += n_events;
+  }
+  return shards;
+}
+
+int main(int argc, char** argv) {
+  int n_threads = std::thread::hardware_concurrency();
+  long n_shards = kDefaultShards;
+  long max_events = 0;
+  std::string output_dir{"."};
+  std::vector<std::string> samples;
+  std::vector<FileCounts> files;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    std::size_t eq = arg.find('=');
+    if (arg == "-j" && i + 1 < argc) {
+      n_threads = std::atoi(argv[++i]);
+    } else if (arg == "-n" && i + 1 < argc) {
+      n_shards = std::atol(argv[++i]);
+    } else if (arg == "-o" && i + 1 < argc) {
+      output_dir = argv[++i];
+    } else if (arg.compare(0, 9, "--events=") == 0) {
+      max_events = std::atol(arg.c_str() + 9);
+    } else if (eq != std::string::npos) {
+      samples.push_back(arg.substr(0, eq));
+      for (const std::string& file : readFileList(arg.substr(eq + 1))) {
+        FileCounts counts;
+        counts.sample = samples.back();
+        counts.lcio_file = file;
+        files.push_back(counts);
+      }
+    } else {
+      samples.clear();
+      break;
+    }
+  }
+  if (samples.empty() || files.empty() || n_threads < 1 || n_shards < 1
+      || max_events < 0) {
+    std::cerr << "Usage: " << argv[0] << " [-j n_threads] [-n n_shards | "
+      << "--events=n] [-o output_dir] new=<file list> old=<file list>"
+      << std::endl;
+    return 1;
+  }
+
+  countEvents(files, std::max(1, std::min<int>(n_threads, files.size())));
+  long n_total = 0;
+  bool has_unreadable = false;
+  for (const FileCounts& file : files) {
+    if (file.n_events < 0) has_unreadable = true;
+    if (file.n_events > 0) n_total += file.n_events;
+  }
+  if (has_unreadable) {
+    std::cerr << "Not all files could be read, no shards are written."
+      << std::endl;
+    return 1;
+  }
+  if (max_events == 0) {
+    max_events = std::max(1L, (n_total + n_shards - 1) / n_shards);
+  }
+
+  for (const std::string& sample : samples) {
+    std::string shard_file = output_dir + "/" + sample + ".shards";
+    std::ofstream out(shard_file, std::ios::trunc);
+    long n_sample_shards = 0;
+    long n_sample_events = 0;
+    long largest = 0;
+    for (const FileCounts& file : files) {
+      if (file.sample != sample || file.n_events <= 0) continue;
+      for (const Shard& shard : splitFile(file, max_events)) {
+        out << shard.lcio_file << " " << shard.first_event << " "
+          << shard.n_events << " " << shard.max_records << "\n";
+        ++n_sample_shards;
+        n_sample_events += shard.n_events;
+        largest = std::max(largest, shard.n_events);
+      }
+    }
+    out.close();
+    if (!out) {
+      std::cerr << "Could not write " << shard_file << "." << std::endl;
+      return 1;
+    }
+    std::cout << shard_file << ": " << n_sample_events << " events in "
+      << n_sample_shards << " shards (at most " << largest << " events each)."
+      << std::endl;
+  }
+  return 0;
+}
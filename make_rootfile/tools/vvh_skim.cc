@@ -0,0 +1,168 @@
+/**
+ *  Converts LCIO files into one skim file (see skim_file.h) for repeated
+ *  truth and overlay-removal passes without LCIO.
+ *
+ *    vvh_skim [--mc=MCParticlesSkimmed] [--pfos=PandoraPFOs]
+ *             [--relations=RecoMCTruthLink] -o output.skim input.slcio ...
+ *
+ *  Only the three collections are read. Per event, the MC graph, the PFO
+ *  four-vectors and types and the MC graph index of the first MCParticle
+ *  related to each PFO are written. Events without MC (or relation)
+ *  collection are kept, with an empty MC graph (or without links).
+ *
+ *  vvh_skim_pass runs the analysis algorithms on the skim file.
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// -- LCIO headers.
+#include "EVENT/LCCollection.h"
+#include "EVENT/LCEvent.h"
+#include "EVENT/LCRelation.h"
+#include "EVENT/MCParticle.h"
+#include "EVENT/ReconstructedParticle.h"
+#include "IO/LCReader.h"
+#include "IOIMPL/LCFactory.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "mc_graph.h"
+#include "skim_file.h"
+
+// -- Using-declarations and global constants.
+using RP = EVENT::ReconstructedParticle;
+using MCP = EVENT::MCParticle;
+
+// ----------------------------------------------------------------------------
+EVENT::LCCollection* findCollection(EVENT::LCEvent* event,
+                                    const std::string& name) {
+  try {
+    return event->getCollection(name);
+  } catch (EVENT::DataNotAvailableException&) {
+    return nullptr;
+  }
+}
+
+// Reused between events.
+struct SkimBuffers {
+  McGraph graph{};
+  std::vector<float> px{};
+  std::vector<float> py{};
+  std::vector<float> pz{};
+  std::vector<float> e{};
+  std::vector<int> type{};
+  std::vector<int> mc_index{};
+  std::unordered_map<const RP*, int> pfo_index{};
+
+  SkimEvent fill(EVENT::LCEvent* event, EVENT::LCCollection* mc_collection,
+                 EVENT::LCCollection* pfos, EVENT::LCCollection* relations) {
+    SkimEvent skim_event;
+    skim_event.run = event->getRunNumber();
+    skim_event.event = event->getEventNumber();
+    if (mc_collection) {
+      graph.build(mc_collection);
+      skim_event.mc = graph.arrays();
+    }
+    px.clear();
+    py.clear();
+    pz.clear();
+    e.clear();
+    type.clear();
+    pfo_index.clear();
+    const int n_pfos = pfos ? pfos->getNumberOfElements() : 0;
+    for (int i = 0; i < n_pfos; ++i) {
+      const RP* rp = static_cast<RP*>(pfos->getElementAt(i));
+      const double* p = rp->getMomentum();
+      px.push_back(p[0]);
+      py.push_back(p[1]);
+      pz.push_back(p[2]);
+      e.push_back(rp->getEnergy());
+      type.push_back(rp->getType());
+      pfo_index.emplace(rp, i);
+    }
+    mc_index.assign(n_pfos, -1);
+    if (mc_collection && relations) {
+      for (int i = 0; i < relations->getNumberOfElements(); ++i) {
+        auto relation = static_cast<EVENT::LCRelation*>(relations->getElementAt(i));
+        auto rp = dynamic_cast<const RP*>(relation->getFrom());
+        auto mcp = dynamic_cast<const MCP*>(relation->getTo());
+        auto it = pfo_index.find(rp);
+        if (!mcp || it == pfo_index.end()) continue;
+        // Only the first relation of a PFO, as in HiggsDescendantIndex.
+        if (mc_index[it->second] < 0) mc_index[it->second] = graph.indexOf(mcp);
+      }
+    }
+    skim_event.px = Span<float>{px.data(), n_pfos};
+    skim_event.py = Span<float>{py.data(), n_pfos};
+    skim_event.pz = Span<float>{pz.data(), n_pfos};
+    skim_event.e = Span<float>{e.data(), n_pfos};
+    skim_event.type = Span<int>{type.data(), n_pfos};
+    skim_event.mc_index = Span<int>{mc_index.data(), n_pfos};
+    return skim_event;
+  }
+};
+
+int main(int argc, char** argv) {
+  std::string mc_name{"MCParticlesSkimmed"};
+  std::string pfo_name{"PandoraPFOs"};
+  std::string relation_name{"RecoMCTruthLink"};
+  std::string output_file{""};
+  std::vector<std::string> input_files;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-o" && i + 1 < argc) {
+      output_file = argv[++i];
+    } else if (arg.compare(0, 5, "--mc=") == 0) {
+      mc_name = arg.substr(5);
+    } else if (arg.compare(0, 7, "--pfos=") == 0) {
+      pfo_name = arg.substr(7);
+    } else if (arg.compare(0, 12, "--relations=") == 0) {
+      relation_name = arg.substr(12);
+    } else {
+      input_files.push_back(arg);
+    }
+  }
+  if (output_file.empty() || input_files.empty()) {
+    std::cerr << "Usage: " << argv[0] << " [--mc=name] [--pfos=name] "
+      << "[--relations=name] -o output.skim input.slcio ..." << std::endl;
+    return 1;
+  }
+
+  std::unique_ptr<IO::LCReader> reader(
+    IOIMPL::LCFactory::getInstance()->createLCReader());
+  reader->setReadCollectionNames({mc_name, pfo_name, relation_name});
+  SkimBuffers buffers;
+  long n_missing_mc = 0;
+  long n_missing_pfos = 0;
+  try {
+    SkimWriter writer(output_file);
+    for (const std::string& file : input_files) {
+      reader->open(file);
+      while (EVENT::LCEvent* event = reader->readNextEvent()) {
+        EVENT::LCCollection* mc_collection = findCollection(event, mc_name);
+        EVENT::LCCollection* pfos = findCollection(event, pfo_name);
+        if (!mc_collection) ++n_missing_mc;
+        if (!pfos) ++n_missing_pfos;
+        writer.write(buffers.fill(event, mc_collection, pfos,
+                                  findCollection(event, relation_name)));
+      }
+      reader->close();
+    }
+    writer.close();
+    std::cout << "Wrote " << writer.nEvents() << " events to " << output_file
+      << "." << std::endl;
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  if (n_missing_mc > 0 || n_missing_pfos > 0) {
+    std::cerr << n_missing_mc << " events without " << mc_name << ", "
+      << n_missing_pfos << " without " << pfo_name << "." << std::endl;
+  }
+  return 0;
+}
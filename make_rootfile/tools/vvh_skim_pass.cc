@@ -0,0 +1,128 @@
+/**
+ *  Truth and overlay-removal pass over skim files (see vvh_skim), without
+ *  LCIO.
+ *
+ *    vvh_skim_pass [-r n_passes] file.skim ...
+ *
+ *  For each event, the Higgs truth (the algorithms of higgs_truth.cc) and the
+ *  Higgs origin of the PFOs (HiggsDescendantIndex, as in the overlay removal)
+ *  are computed directly on the memory-mapped arrays. Per Higgs decay mode,
+ *  the number of events, the mean number of PFOs with and without overlay and
+ *  the mean mass of the Higgs-only PFOs are printed, together with the event
+ *  throughput. With -r, the pass is repeated (e.g. to time it with a warm
+ *  page cache).
+ *
+ *    @author Jonas Kunath, LLR, CNRS, École Polytechnique, IPP.
+ */
+// -- C++ STL headers.
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+// -- Marlin headers.
+#include "streamlog/streamlog.h"
+
+// -- Header for this processor and other project-specific headers.
+#include "higgs_descendant_index.h"
+#include "make_higgs_variables.h"
+#include "pfo_kinematics.h"
+#include "skim_file.h"
+
+// -- Using-declarations and global constants.
+using Clock = std::chrono::steady_clock;
+
+// ----------------------------------------------------------------------------
+struct DecaySummary {
+  long n_events = 0;
+  double n_pfos = 0;
+  double n_higgs_pfos = 0;
+  double m_higgs = 0;
+};
+
+double mass(const PfoKinematics::Sums& sums) {
+  double m2 = sums.e * sums.e
+    - sums.px * sums.px - sums.py * sums.py - sums.pz * sums.pz;
+  return m2 > 0 ? std::sqrt(m2) : 0;
+}
+
+int main(int argc, char** argv) {
+  int n_passes = 1;
+  std::vector<std::string> skim_files;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg(argv[i]);
+    if (arg == "-r" && i + 1 < argc) {
+      n_passes = std::atoi(argv[++i]);
+    } else {
+      skim_files.push_back(arg);
+    }
+  }
+  if (skim_files.empty() || n_passes < 1) {
+    std::cerr << "Usage: " << argv[0] << " [-r n_passes] file.skim ..."
+      << std::endl;
+    return 1;
+  }
+  streamlog::out.init(std::cout, argv[0]);
+
+  // Only its truth algorithms are used, the processor is not initialized.
+  MakeHiggsVariablesProcessor truth;
+  HiggsDescendantIndex higgs_index;
+  PfoKinematics pfos;
+  PfoKinematics higgs_pfos;
+  std::map<int, DecaySummary> summaries;
+  long n_events = 0;
+  Clock::time_point start = Clock::now();
+  try {
+    for (int pass = 0; pass < n_passes; ++pass) {
+      summaries.clear();
+      for (const std::string& file : skim_files) {
+        SkimReader skim(file);
+        for (long i = 0; i < skim.nEvents(); ++i) {
+          SkimEvent event = skim.event(i);
+          MakeHiggsVariablesProcessor::HiggsTruth higgs_truth =
+            truth.getHiggsTruth(event.mc);
+          higgs_index.build(truth.mcGraph());
+          pfos.clear();
+          higgs_pfos.clear();
+          for (int p = 0; p < event.nPfos(); ++p) {
+            pfos.add(event.px[p], event.py[p], event.pz[p], event.e[p],
+                     event.type[p]);
+            if (higgs_index.isFromHiggs(event.mc_index[p])) {
+              higgs_pfos.add(event.px[p], event.py[p], event.pz[p], event.e[p],
+                             event.type[p]);
+            }
+          }
+          DecaySummary& summary = summaries[higgs_truth.decay_mode];
+          ++summary.n_events;
+          summary.n_pfos += pfos.size();
+          summary.n_higgs_pfos += higgs_pfos.size();
+          summary.m_higgs += mass(higgs_pfos.compute());
+          ++n_events;
+        }
+      }
+    }
+  } catch (std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+  std::chrono::duration<double> seconds = Clock::now() - start;
+
+  std::cout << std::setw(8) << "h_decay" << std::setw(12) << "events"
+    << std::setw(12) << "n_pfos" << std::setw(14) << "n_higgs_pfos"
+    << std::setw(12) << "m_higgs" << std::endl;
+  for (const auto& mode_summary : summaries) {
+    const DecaySummary& summary = mode_summary.second;
+    std::cout << std::setw(8) << mode_summary.first
+      << std::setw(12) << summary.n_events << std::fixed << std::setprecision(2)
+      << std::setw(12) << summary.n_pfos / summary.n_events
+      << std::setw(14) << summary.n_higgs_pfos / summary.n_events
+      << std::setw(12) << summary.m_higgs / summary.n_events << std::endl;
+  }
+  std::cout << n_events << " events in " << seconds.count() << " s ("
+    << n_events / seconds.count() << " events/s)." << std::endl;
+  return 0;
+}